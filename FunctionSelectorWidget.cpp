@@ -1,12 +1,15 @@
 #include "FunctionSelectorWidget.h"
 #include "LogConsoleWidget.h"
+#include "LoggingSymbols.h"
 #include "qboxlayout.h"
 #include "qcheckbox.h"
+#include "qcombobox.h"
+#include "qdatetimeedit.h"
 #include "qheaderview.h"
 #include "qlineedit.h"
 #include "qmenu.h"
 #include "qpushbutton.h"
-#include "qstandarditemmodel.h"
+#include "qspinbox.h"
 #include <QTreeWidget>
 
 using namespace Logging;
@@ -39,6 +42,35 @@ FunctionSelectorWidget::FunctionSelectorWidget(LogConsoleWidget* parent):
     QHBoxLayout* Hlayout1 = new QHBoxLayout();
     layout->addLayout(Hlayout1, 1);
 
+    // фильтр по времени: все время, последние N минут или интервал
+    QHBoxLayout* timeLayout = new QHBoxLayout();
+    layout->addLayout(timeLayout, 1);
+    m_timeFilterBox = new QComboBox(this);
+    m_timeFilterBox->addItem("Все время", ConsoleSettings::TimeFilterOff);
+    m_timeFilterBox->addItem("Последние", ConsoleSettings::TimeFilterLastMinutes);
+    m_timeFilterBox->addItem("Интервал", ConsoleSettings::TimeFilterRange);
+    timeLayout->addWidget(m_timeFilterBox);
+    m_lastMinutesBox = new QSpinBox(this);
+    m_lastMinutesBox->setRange(1, 7 * 24 * 60);
+    m_lastMinutesBox->setSuffix(" мин");
+    timeLayout->addWidget(m_lastMinutesBox);
+
+    QHBoxLayout* rangeLayout = new QHBoxLayout();
+    layout->addLayout(rangeLayout, 1);
+    m_timeFromEdit = new QDateTimeEdit(this);
+    m_timeFromEdit->setDisplayFormat("yyyy-MM-dd hh:mm:ss");
+    m_timeFromEdit->setCalendarPopup(true);
+    rangeLayout->addWidget(m_timeFromEdit);
+    m_timeToEdit = new QDateTimeEdit(this);
+    m_timeToEdit->setDisplayFormat("yyyy-MM-dd hh:mm:ss");
+    m_timeToEdit->setCalendarPopup(true);
+    rangeLayout->addWidget(m_timeToEdit);
+
+    connect(m_timeFilterBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &FunctionSelectorWidget::applyTimeFilter);
+    connect(m_lastMinutesBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &FunctionSelectorWidget::applyTimeFilter);
+    connect(m_timeFromEdit, &QDateTimeEdit::dateTimeChanged, this, &FunctionSelectorWidget::applyTimeFilter);
+    connect(m_timeToEdit, &QDateTimeEdit::dateTimeChanged, this, &FunctionSelectorWidget::applyTimeFilter);
+
 
     // Создание меню
     m_logLevelMenu = new QMenu(this);
@@ -48,8 +80,10 @@ FunctionSelectorWidget::FunctionSelectorWidget(LogConsoleWidget* parent):
         action1->setChecked(m_parent->m_settings.enableLogMsgs.infoMsg);
     m_logLevelMenu->addAction(action1);
     connect(action1, &QAction::toggled, this, [&](bool state){
-        if(m_parent)
+        if(m_parent){
             m_parent->m_settings.enableLogMsgs.infoMsg = state;
+            m_parent->updateContent(); // список строк пересчитывается в фоне, повторный клик отменяет прошлый
+        }
     });
 
     QAction *action2 = new QAction("display debug", m_logLevelMenu);
@@ -58,8 +92,10 @@ FunctionSelectorWidget::FunctionSelectorWidget(LogConsoleWidget* parent):
         action2->setChecked(m_parent->m_settings.enableLogMsgs.debugMsg);
     m_logLevelMenu->addAction(action2);
     connect(action2, &QAction::toggled, this, [&](bool state){
-        if(m_parent)
+        if(m_parent){
             m_parent->m_settings.enableLogMsgs.debugMsg = state;
+            m_parent->updateContent();
+        }
     });
 
     QAction *action3 = new QAction("display warning", m_logLevelMenu);
@@ -68,8 +104,10 @@ FunctionSelectorWidget::FunctionSelectorWidget(LogConsoleWidget* parent):
         action3->setChecked(m_parent->m_settings.enableLogMsgs.warningMsg);
     m_logLevelMenu->addAction(action3);
     connect(action3, &QAction::toggled, this, [&](bool state){
-        if(m_parent)
+        if(m_parent){
             m_parent->m_settings.enableLogMsgs.warningMsg = state;
+            m_parent->updateContent();
+        }
     });
 
     QAction *action4 = new QAction("display critical", m_logLevelMenu);
@@ -78,8 +116,10 @@ FunctionSelectorWidget::FunctionSelectorWidget(LogConsoleWidget* parent):
         action4->setChecked(m_parent->m_settings.enableLogMsgs.criticalMsg);
     m_logLevelMenu->addAction(action4);
     connect(action4, &QAction::toggled, this, [&](bool state){
-        if(m_parent)
+        if(m_parent){
             m_parent->m_settings.enableLogMsgs.criticalMsg = state;
+            m_parent->updateContent();
+        }
     });
 
     QAction *action5 = new QAction("display fatal", m_logLevelMenu);
@@ -88,10 +128,17 @@ FunctionSelectorWidget::FunctionSelectorWidget(LogConsoleWidget* parent):
         action5->setChecked(m_parent->m_settings.enableLogMsgs.fatalMsg);
     m_logLevelMenu->addAction(action5);
     connect(action5, &QAction::toggled, this, [&](bool state){
-        if(m_parent)
+        if(m_parent){
             m_parent->m_settings.enableLogMsgs.fatalMsg = state;
+            m_parent->updateContent();
+        }
     });
 
+    // подменю уровней по категориям QLoggingCategory (глобальные маски CategoryTable)
+    m_logLevelMenu->addSeparator();
+    m_categoryMenu = m_logLevelMenu->addMenu("categories");
+    connect(m_categoryMenu, &QMenu::aboutToShow, this, &FunctionSelectorWidget::updateCategoryMenu);
+
 
 
     // Подключаем кнопку к открытию подменю включения уровня логирования
@@ -163,19 +210,62 @@ FunctionSelectorWidget::~FunctionSelectorWidget()
 
 void FunctionSelectorWidget::addFunction(const QString &path)
 {
-    QStringList parts = path.split("::");
-    if(parts.size() < 0) return;
+    addFunction(Logging::FunctionTable::intern(path));
+}
+
+void FunctionSelectorWidget::addFunction(quint32 id)
+{
+    // функция уже в древе - поиск по id вместо прохода по веткам
+    if(id < (quint32)m_addedFunctions.size() && m_addedFunctions.at(id)) return;
+    const QStringList& parts = Logging::FunctionTable::components(id);
+    if(parts.isEmpty()) return;
 
     QTreeWidgetItem *item = m_treeWidget->invisibleRootItem();
     for(int i = 0; i < parts.size(); i++)
     {
         item = findOrCreateItem(item, parts[i]);
     }
+    if(id >= (quint32)m_addedFunctions.size())
+        m_addedFunctions.resize(id + 1);
+    m_addedFunctions[id] = true;
 }
 
-void FunctionSelectorWidget::setCheckStateFunction(const QString &path, bool st)
+void FunctionSelectorWidget::removeFunction(quint32 id)
 {
-    QStringList parts = path.split("::");
+    if(id >= (quint32)m_addedFunctions.size() || !m_addedFunctions.at(id)) return;
+    const QStringList& parts = Logging::FunctionTable::components(id);
+
+    QTreeWidgetItem *root = m_treeWidget->invisibleRootItem();
+    QTreeWidgetItem *item = root;
+    for(const QString& part : parts)
+    {
+        QTreeWidgetItem *found = nullptr;
+        for(int j = 0; j < item->childCount(); j++){
+            if(item->child(j)->text(0) == part){
+                found = item->child(j);
+                break;
+            }
+        }
+        if(!found) return;
+        item = found;
+    }
+
+    // поднимаемся к корню, пока ветка пуста и отмечена
+    while(item != root && !item->childCount())
+    {
+        QCheckBox *checkBox = qobject_cast<QCheckBox *>(m_treeWidget->itemWidget(item, 1));
+        if(!checkBox || checkBox->checkState() != Qt::Checked) break;
+        QTreeWidgetItem *parentItem = item->parent() ? item->parent() : root;
+        removeItem(item);
+        item = parentItem;
+    }
+    if(item->childCount())
+        updateParentCheckBox(item->child(0));
+}
+
+void FunctionSelectorWidget::setCheckStateFunction(quint32 id, bool st)
+{
+    const QStringList& parts = Logging::FunctionTable::components(id);
     if(parts.isEmpty()) return;
 
     QTreeWidgetItem *item = m_treeWidget->invisibleRootItem();
@@ -311,6 +401,9 @@ void FunctionSelectorWidget::removeItem(QTreeWidgetItem *item)
     m_treeWidget->removeItemWidget(item, 1);
     delete w;
 
+    // функции удаленной ветки снова добавятся в древо при следующем появлении в логах
+    m_addedFunctions.clear();
+
     //удаляем ветку древа
     QTreeWidgetItem *parentItem;
     parentItem = item->parent();
@@ -323,6 +416,37 @@ void FunctionSelectorWidget::removeItem(QTreeWidgetItem *item)
     delete item;
 }
 
+void FunctionSelectorWidget::updateTimeFilter()
+{
+    if(!m_parent) return;
+    const ConsoleSettings& settings = m_parent->m_settings;
+    for(QWidget* w : std::initializer_list<QWidget*>{m_timeFilterBox, m_lastMinutesBox, m_timeFromEdit, m_timeToEdit})
+        w->blockSignals(true);
+    m_timeFilterBox->setCurrentIndex(m_timeFilterBox->findData(settings.timeFilter));
+    m_lastMinutesBox->setValue(settings.filterLastMinutes);
+    // интервал по умолчанию - последний час
+    qint64 now = Time::now();
+    m_timeFromEdit->setDateTime(Time::toDateTime(settings.filterStartTime ? settings.filterStartTime : now - 60 * 60 * 1000));
+    m_timeToEdit->setDateTime(Time::toDateTime(settings.filterEndTime ? settings.filterEndTime : now));
+    for(QWidget* w : std::initializer_list<QWidget*>{m_timeFilterBox, m_lastMinutesBox, m_timeFromEdit, m_timeToEdit})
+        w->blockSignals(false);
+    applyTimeFilter();
+}
+
+void FunctionSelectorWidget::applyTimeFilter()
+{
+    if(!m_parent) return;
+    ConsoleSettings& settings = m_parent->m_settings;
+    settings.timeFilter = m_timeFilterBox->currentData().toInt();
+    settings.filterLastMinutes = m_lastMinutesBox->value();
+    settings.filterStartTime = Time::fromDateTime(m_timeFromEdit->dateTime()) / 1000 * 1000;
+    // поле показывает секунды: конец интервала включает всю секунду
+    settings.filterEndTime = Time::fromDateTime(m_timeToEdit->dateTime()) / 1000 * 1000 + 999;
+    m_lastMinutesBox->setVisible(settings.timeFilter == ConsoleSettings::TimeFilterLastMinutes);
+    m_timeFromEdit->setVisible(settings.timeFilter == ConsoleSettings::TimeFilterRange);
+    m_timeToEdit->setVisible(settings.timeFilter == ConsoleSettings::TimeFilterRange);
+}
+
 void FunctionSelectorWidget::filterTree(const QString &text)
 {
     searchTreeElement(m_treeWidget->invisibleRootItem(), text);
@@ -341,33 +465,7 @@ int FunctionSelectorWidget::searchTreeElement(QTreeWidgetItem *item, const QStri
     return matches;
 }
 
-void FunctionSelectorWidget::convertTreeWidgetToStandardItemModel(QStandardItem *parentItem, QTreeWidgetItem *treeWidgetItem)
-{
-    int childCount = treeWidgetItem->childCount();
-    for(int i = 0; i < childCount; ++i)
-    {
-        QTreeWidgetItem *childTreeItem = treeWidgetItem->child(i);
-
-        QCheckBox *checkBox = qobject_cast<QCheckBox *>(m_treeWidget->itemWidget(childTreeItem, 1));
-
-        if(checkBox)
-        {
-            Qt::CheckState state = checkBox->checkState();
-            QStandardItem *childStandardItem = new QStandardItem(childTreeItem->text(0));
-
-            childStandardItem->setData(state, Qt::UserRole);
-            parentItem->appendRow(childStandardItem);
-
-            if(state == Qt::CheckState::PartiallyChecked)
-            {
-                // Рекурсивно добавляем потомков
-                convertTreeWidgetToStandardItemModel(childStandardItem, childTreeItem);
-            }
-        }
-    }
-}
-
-void FunctionSelectorWidget::convertTreeWidgetToVector(QVector<QPair<QString, bool>> &vector, QString func,
+void FunctionSelectorWidget::convertTreeWidgetToVector(QVector<QPair<quint32, bool>> &vector, QString func,
                                                        QTreeWidgetItem *treeWidgetItem)
 {
     int childCount = treeWidgetItem->childCount();
@@ -385,8 +483,8 @@ void FunctionSelectorWidget::convertTreeWidgetToVector(QVector<QPair<QString, bo
             QCheckBox *checkBox = qobject_cast<QCheckBox *>(m_treeWidget->itemWidget(childTreeItem, 1));
             if(checkBox)
             {
-                QPair<QString, bool> pair;
-                pair.first = func + childTreeItem->text(0);
+                QPair<quint32, bool> pair;
+                pair.first = Logging::FunctionTable::intern(func + childTreeItem->text(0));
                 pair.second = checkBox->isChecked();
                 vector.append(pair);
             }
@@ -399,39 +497,45 @@ void FunctionSelectorWidget::sortItems()
     m_treeWidget->sortItems(0, Qt::AscendingOrder);
 }
 
-QStandardItemModel *FunctionSelectorWidget::convertToStandardItemModel()
+QVector<bool> FunctionSelectorWidget::functionFilter()
 {
-    QStandardItemModel *model = new QStandardItemModel();
+    quint32 count = Logging::FunctionTable::count();
+    QVector<bool> filter(count, true);
+    for(quint32 id = 1; id < count; id++)
+        filter[id] = isFunctionChecked(Logging::FunctionTable::components(id));
+    return filter;
+}
 
-    int topLevelCount = m_treeWidget->topLevelItemCount();
-    for(int i = 0; i < topLevelCount; ++i)
+bool FunctionSelectorWidget::isFunctionChecked(const QStringList &parts)
+{
+    QTreeWidgetItem *item = m_treeWidget->invisibleRootItem();
+    for(const QString& part : parts)
     {
-        QTreeWidgetItem *topLevelItem = m_treeWidget->topLevelItem(i);
-
-        QCheckBox *checkbox = qobject_cast<QCheckBox *>(m_treeWidget->itemWidget(topLevelItem, 1));
-
-        if(checkbox)
-        {
-            Qt::CheckState state = checkbox->checkState();
-            QStandardItem *topLevelStandardItem = new QStandardItem(topLevelItem->text(0));
-
-            topLevelStandardItem->setData(state, Qt::UserRole);
-            model->appendRow(topLevelStandardItem);
-
-            if(state == Qt::CheckState::PartiallyChecked)
-            {
-                // Рекурсивно добавляем потомков
-                convertTreeWidgetToStandardItemModel(topLevelStandardItem, topLevelItem);
+        QTreeWidgetItem *found = nullptr;
+        for(int j = 0; j < item->childCount(); j++){
+            if(item->child(j)->text(0) == part){
+                found = item->child(j);
+                break;
             }
         }
+        // если функция не найдена - считаем что она отмечена и отображение включено
+        if(!found) return true;
+
+        QCheckBox *checkBox = qobject_cast<QCheckBox *>(m_treeWidget->itemWidget(found, 1));
+        if(!checkBox) return true;
+        Qt::CheckState state = checkBox->checkState();
+        if(state == Qt::CheckState::Checked)
+            return true;
+        if(state == Qt::CheckState::Unchecked)
+            return false;
+        item = found; // PartiallyChecked - решают потомки
     }
-
-    return model;
+    return true;
 }
 
-QVector<QPair<QString, bool>> FunctionSelectorWidget::convertToVector()
+QVector<QPair<quint32, bool>> FunctionSelectorWidget::convertToVector()
 {
-    QVector<QPair<QString, bool>> vector;
+    QVector<QPair<quint32, bool>> vector;
 
     int topLevelCount = m_treeWidget->topLevelItemCount();
     for(int i = 0; i < topLevelCount; ++i)
@@ -447,8 +551,8 @@ QVector<QPair<QString, bool>> FunctionSelectorWidget::convertToVector()
             QCheckBox *checkBox = qobject_cast<QCheckBox *>(m_treeWidget->itemWidget(topLevelItem, 1));
             if(checkBox)
             {
-                QPair<QString, bool> pair;
-                pair.first = topLevelItem->text(0);
+                QPair<quint32, bool> pair;
+                pair.first = Logging::FunctionTable::intern(topLevelItem->text(0));
                 pair.second = checkBox->checkState();
                 vector.append(pair);
             }
@@ -460,6 +564,9 @@ QVector<QPair<QString, bool>> FunctionSelectorWidget::convertToVector()
 void FunctionSelectorWidget::updateEnablesLogMsgs()
 {
     QList<QAction*> actions = m_logLevelMenu->actions();
+    // вызывается под m_mutex консоли (loadSettings): toggled -> updateContent здесь не нужен
+    for(QAction* action : std::as_const(actions))
+        action->blockSignals(true);
     if(actions.size()>=5 && m_parent){
         actions[0]->setChecked(m_parent->m_settings.enableLogMsgs.infoMsg);
         actions[1]->setChecked(m_parent->m_settings.enableLogMsgs.debugMsg);
@@ -467,4 +574,47 @@ void FunctionSelectorWidget::updateEnablesLogMsgs()
         actions[3]->setChecked(m_parent->m_settings.enableLogMsgs.criticalMsg);
         actions[4]->setChecked(m_parent->m_settings.enableLogMsgs.fatalMsg);
     }
+    for(QAction* action : std::as_const(actions))
+        action->blockSignals(false);
+}
+
+void FunctionSelectorWidget::updateCategoryMenu()
+{
+    // список категорий только растет во время работы: подменю создаются один раз,
+    // при каждом открытии обновляются отметки и добавляются подменю новых категорий
+    const QList<QPair<QString, QtMsgType>> levels = {
+        {"info", QtInfoMsg}, {"debug", QtDebugMsg}, {"warning", QtWarningMsg},
+        {"critical", QtCriticalMsg}, {"fatal", QtFatalMsg}};
+
+    for(quint32 id = 0; id < (quint32)m_categoryMenus.size(); id++)
+    {
+        const QList<QAction*> actions = m_categoryMenus[id]->actions();
+        for(int i = 0; i < actions.size() && i < levels.size(); i++)
+        {
+            // отметка меняется программно: toggled -> updateContent здесь не нужен
+            QSignalBlocker blocker(actions[i]);
+            actions[i]->setChecked(Logging::CategoryTable::isEnabled(id, levels[i].second));
+        }
+    }
+
+    for(quint32 id = m_categoryMenus.size(); id < Logging::CategoryTable::count(); id++)
+    {
+        QMenu* menu = m_categoryMenu->addMenu(Logging::CategoryTable::name(id));
+        m_categoryMenus.append(menu);
+        for(const auto &level : levels)
+        {
+            QAction* action = menu->addAction(level.first);
+            action->setCheckable(true);
+            action->setChecked(Logging::CategoryTable::isEnabled(id, level.second));
+            QtMsgType type = level.second;
+            connect(action, &QAction::toggled, this, [this, id, type](bool state){
+                quint8 mask = Logging::CategoryTable::mask(id);
+                if(state) mask |= Logging::levelBit(type);
+                else mask &= ~Logging::levelBit(type);
+                Logging::CategoryTable::setMask(id, mask);
+                if(m_parent)
+                    m_parent->updateContent();
+            });
+        }
+    }
 }
@@ -4,14 +4,15 @@
 
 
 class QCheckBox;
+class QComboBox;
+class QDateTimeEdit;
 class QLineEdit;
+class QSpinBox;
 class QMenu;
 class QVBoxLayout;
 class QTreeWidget;
 class QTreeWidgetItem;
 class QPushButton;
-class QStandardItemModel;
-class QStandardItem;
 
 namespace Logging
 {
@@ -32,11 +33,21 @@ public:
      *  по формату namespace::function
      */
     void addFunction(const QString& path);
+    /*!
+     * \brief addFunction добавляет функцию по id из FunctionTable,
+     *  уже добавленные id пропускаются без обхода древа
+     */
+    void addFunction(quint32 id);
+    /*!
+     * \brief removeFunction убирает функцию из древа, когда от нее не осталось строк в истории.
+     *  Отмеченные ветки без потомков удаляются, снятые пользователем отметки сохраняются как фильтр
+     */
+    void removeFunction(quint32 id);
     /*!
      * \brief setCheckStateFunction устанавливает состояние checkbox
      *  у соответствующей функции
      */
-    void setCheckStateFunction(const QString& path, bool st);
+    void setCheckStateFunction(quint32 id, bool st);
     /*!
      * \brief sortItems сортирует функции по названию в древе
      */
@@ -44,17 +55,26 @@ public:
 
 
     /*!
-     * \brief convertToStandardItemModel конвертирует QTreeWidget в QStandardItemModel
-     * с которым будет работать сортировщик для ускорения
+     * \brief functionFilter строит фильтр функций по состоянию древа:
+     *  вектор, индексированный id из FunctionTable (см. ConsoleSettings::functions)
      */
-    QStandardItemModel* convertToStandardItemModel();
+    QVector<bool> functionFilter();
     /*!
-     * \brief convertToVector конвертирует древо в вектор
+     * \brief convertToVector конвертирует древо в вектор (id функции, состояние)
      *  для удобного сохранения в файл
      */
-    QVector<QPair<QString, bool>> convertToVector();
+    QVector<QPair<quint32, bool>> convertToVector();
 
     void updateEnablesLogMsgs();
+    /*!
+     * \brief updateCategoryMenu обновляет подменю уровней логирования по категориям:
+     *  отметки уровней существующих подменю и новые подменю для появившихся категорий
+     */
+    void updateCategoryMenu();
+    /*!
+     * \brief updateTimeFilter показывает в полях фильтра по времени текущие настройки консоли
+     */
+    void updateTimeFilter();
 
 private:
     LogConsoleWidget* m_parent;
@@ -63,9 +83,16 @@ private:
     QTreeWidget* m_treeWidget;
     QLineEdit* m_addField;
     QMenu *m_logLevelMenu;
+    QMenu *m_categoryMenu;
+    QVector<QMenu*> m_categoryMenus; // подменю категорий, индекс - id категории
     QPushButton* m_logLevelButton;
     QPushButton* m_addButton;
     QPushButton* m_removeButton;
+    QComboBox* m_timeFilterBox;
+    QSpinBox* m_lastMinutesBox;
+    QDateTimeEdit* m_timeFromEdit;
+    QDateTimeEdit* m_timeToEdit;
+    QVector<bool> m_addedFunctions; // id функций, уже добавленных в древо
 
     /*!
      * \brief findOrCreateItem находит элемент по имени среди наследников или создает его
@@ -83,14 +110,23 @@ private:
      * \brief filterTree отфильтровать древо по ветвям
      *  содержащим данный текст(имя0)     */
     void filterTree(const QString& text);
+    /*!
+     * \brief applyTimeFilter записывает фильтр по времени из полей в настройки консоли
+     *  (применяется вместе с остальными правилами при закрытии окна)
+     */
+    void applyTimeFilter();
     /*!
      * \brief searchTreeElement рекурсивный поиск элементов в древе
      * скрывает ветки если нет совпадений */
     int searchTreeElement(QTreeWidgetItem* item, const QString& text);
 
 
-    void convertTreeWidgetToStandardItemModel(QStandardItem* parentItem, QTreeWidgetItem* treeWidgetItem);
-    void convertTreeWidgetToVector(QVector<QPair<QString, bool>>& parentItem, QString func, QTreeWidgetItem* treeWidgetItem);
+    /*!
+     * \brief isFunctionChecked проходит по древу по частям имени функции
+     *  (Checked/Unchecked решают сразу, PartiallyChecked - переход к потомкам)
+     */
+    bool isFunctionChecked(const QStringList& parts);
+    void convertTreeWidgetToVector(QVector<QPair<quint32, bool>>& parentItem, QString func, QTreeWidgetItem* treeWidgetItem);
 };
 
 };//Logging
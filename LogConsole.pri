@@ -6,8 +6,21 @@ CONFIG += c++17
 SOURCES += \
     $$PWD/FunctionSelectorWidget.cpp \
     $$PWD/LogConsoleWidget.cpp \
+    $$PWD/LogHistory.cpp \
+    $$PWD/LogLinesDisplayWidget.cpp \
+    $$PWD/LogFileFollower.cpp \
+    $$PWD/LogFileIndex.cpp \
+    $$PWD/LogFileReader.cpp \
+    $$PWD/LogLineParser.cpp \
+    $$PWD/LogSearch.cpp \
     $$PWD/LogWidgetSettings.cpp \
     $$PWD/Logging.cpp \
+    $$PWD/LoggingBackend.cpp \
+    $$PWD/LoggingEncoder.cpp \
+    $$PWD/LoggingRateLimit.cpp \
+    $$PWD/LoggingSinks.cpp \
+    $$PWD/LoggingSymbols.cpp \
+    $$PWD/LoggingTime.cpp \
     $$PWD/main.cpp
 
 FORMS += \
@@ -17,9 +30,23 @@ FORMS += \
 HEADERS += \
     $$PWD/FunctionSelectorWidget.h \
     $$PWD/LogConsoleWidget.h \
+    $$PWD/LogHistory.h \
+    $$PWD/LogLinesDisplayWidget.h \
+    $$PWD/LogFileFollower.h \
+    $$PWD/LogFileIndex.h \
+    $$PWD/LogFileReader.h \
+    $$PWD/LogLineParser.h \
+    $$PWD/LogSearch.h \
     $$PWD/LogWidgetSettings.h \
     $$PWD/Logging.h	\
-    $$PWD/LoggingEncoder.h
+    $$PWD/LoggingEncoder.h \
+    $$PWD/LoggingBackend.h \
+    $$PWD/LoggingConcurrent.h \
+    $$PWD/LoggingQueue.h \
+    $$PWD/LoggingRateLimit.h \
+    $$PWD/LoggingSinks.h \
+    $$PWD/LoggingSymbols.h \
+    $$PWD/LoggingTime.h
 
 RESOURCES += \
     $$PWD/ConsoleResources.qrc
@@ -11,8 +11,21 @@ CONFIG += c++17
 SOURCES += \
     FunctionSelectorWidget.cpp \
     LogConsoleWidget.cpp \
+    LogHistory.cpp \
+    LogLinesDisplayWidget.cpp \
+    LogFileFollower.cpp \
+    LogFileIndex.cpp \
+    LogFileReader.cpp \
+    LogLineParser.cpp \
+    LogSearch.cpp \
     LogWidgetSettings.cpp \
     Logging.cpp \
+    LoggingBackend.cpp \
+    LoggingEncoder.cpp \
+    LoggingRateLimit.cpp \
+    LoggingSinks.cpp \
+    LoggingSymbols.cpp \
+    LoggingTime.cpp \
     main.cpp
 
 
@@ -29,9 +42,23 @@ FORMS += \
 HEADERS += \
     FunctionSelectorWidget.h \
     LogConsoleWidget.h \
+    LogHistory.h \
+    LogLinesDisplayWidget.h \
+    LogFileFollower.h \
+    LogFileIndex.h \
+    LogFileReader.h \
+    LogLineParser.h \
+    LogSearch.h \
     LogWidgetSettings.h \
     Logging.h \
-    LoggingEncoder.h
+    LoggingEncoder.h \
+    LoggingBackend.h \
+    LoggingConcurrent.h \
+    LoggingQueue.h \
+    LoggingRateLimit.h \
+    LoggingSinks.h \
+    LoggingSymbols.h \
+    LoggingTime.h
 
 RESOURCES += \
     ConsoleResources.qrc
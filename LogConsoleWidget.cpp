@@ -1,26 +1,44 @@
 #include "LogConsoleWidget.h"
 #include "FunctionSelectorWidget.h"
+#include "LogFileFollower.h"
+#include "LogFileIndex.h"
+#include "LogFileReader.h"
+#include "LogLineParser.h"
+#include "LogSearch.h"
 #include "LogWidgetSettings.h"
 #include "Logging.h"
-#include "LoggingEncoder.h"
+#include "LoggingConcurrent.h"
 #include "qdatetime.h"
 #include "qdebug.h"
+#include "qelapsedtimer.h"
 #include "qevent.h"
 #include "qfileinfo.h"
 #include "qlocale.h"
+#include "qmetaobject.h"
 #include "qscreen.h"
-#include "qscrollbar.h"
 #include "qsettings.h"
-#include "qstandarditemmodel.h"
+#include "qshortcut.h"
 #include "qstyle.h"
-#include "qtextdocumentfragment.h"
+#include "qtextdocument.h"
+#include "qthread.h"
+#include "qthreadpool.h"
+#include "qtimer.h"
 #include "ui_logconsolewidget.h"
 #include <QWidget>
-#include <QTextEdit>
-#include <QtConcurrent>
+#include <algorithm>
+#include <limits>
 using namespace Logging;
 #include <qdockwidget.h>
-const int line_count = 50; // count in block (for history & processing)
+const qint64 load_range_min = 1024 * 1024;      // байт файла логов в одной задаче разбора - не меньше
+const qint64 load_range_max = 16 * 1024 * 1024; // и не больше
+const int load_ranges_per_thread = 8;           // задач на поток: запас для выравнивания нагрузки
+const int load_tail_lines = 10000;           // последние строки файла, показываемые сразу
+const int seek_window_chunks = 16;           // кусков индекса файла, загружаемых при переходе к строке
+const int filter_chunk_size = 65536; // строк истории в одной задаче фильтрации
+const int filter_cancel_check = 4096; // как часто задача фильтрации проверяет отмену
+const int default_frame_interval = 16; // период кадра отрисовки, мс
+const int frame_slice_lines = 512;     // строк между проверками бюджета кадра
+const int filter_block_size = 1024;    // строк в одном проходе фильтра по колонкам истории
 
 //загрука ресурсов (при загрузке статической )
 static bool initMyResources() { Q_INIT_RESOURCE(ConsoleResources); return true; }
@@ -36,8 +54,12 @@ ConsoleFormatter::ConsoleFormatter(ConsoleSettings *settings)
 {
     m_releaseMem = true;
     m_settings = new ConsoleSettings();
-    *m_settings = *settings;
-    m_settings->functions = nullptr;
+    *m_settings = *settings; // фильтр функций - неявно разделяемый QVector, копия дешевая
+}
+
+ConsoleFormatter::ConsoleFormatter(const ConsoleFormatter &other) :
+    ConsoleFormatter(other.m_settings)
+{
 }
 
 ConsoleFormatter::~ConsoleFormatter(){
@@ -47,34 +69,6 @@ ConsoleFormatter::~ConsoleFormatter(){
 }
 
 
-QPair<QVector<LogLine>, QStringList> ConsoleFormatter::stringList2LogLines(const QStringList &block)
-{
-    QVector<LogLine> logLines;
-    QStringList functions;
-
-    for(const QString& line : block){
-        if(line.isEmpty()) continue;
-        LogLine logLine;
-
-        QString decodedLine;
-        bool success = Logging::Encoder::decodeLineString(line, decodedLine);
-        if(success && decodedLine.size()){
-            logLine = LogLine(decodedLine);
-        } else {
-            logLine = LogLine(line);
-        }
-        //parse or decoding Error
-        if(logLine.only_message){
-            logLine.type = QtWarningMsg;
-            logLine.message = "LogLine decoding Error: " + logLine.message;
-        }
-
-        functions.append(logLine.functionStr);
-        logLines.append(logLine);
-    }
-    return {logLines, functions};
-}
-
 QTextDocument* ConsoleFormatter::formatBlockToDoc(const QVector<LogLine> &block)
 {
     QTextDocument* doc = new QTextDocument();
@@ -91,44 +85,36 @@ void ConsoleFormatter::appendFormatedLine(QTextCursor *curs, const LogLine &line
     if(line.only_message)
         appendSimpleLine(curs, line.type, line.message);
     else
-        appendFormatedLine(curs, line.type, line.dateTime, line.functionStr, line.message);
+        appendFormatedLine(curs, line.type, line.timestamp, line.functionId, line.message, line.categoryId);
 }
 
-void ConsoleFormatter::appendFormatedLine(QTextCursor* curs, QtMsgType type, const QDateTime& date,
-                                          const QString& func, const QString& msg)
+void ConsoleFormatter::appendFormatedLine(QTextCursor* curs, QtMsgType type, qint64 timestamp,
+                                          quint32 function, const QString& msg, quint32 category)
 {
     // исключаем строки если имеют уровень логирования который отключен в настройках
-    switch(type){
-    case QtInfoMsg:
-        if(!m_settings->enableLogMsgs.infoMsg)return;
-        break;
-    case QtWarningMsg:
-        if(!m_settings->enableLogMsgs.warningMsg)return;
-        break;
-    case QtDebugMsg:
-        if(!m_settings->enableLogMsgs.debugMsg)return;
-        break;
-    case QtCriticalMsg:
-        if(!m_settings->enableLogMsgs.criticalMsg)return;
-        break;
-    case QtFatalMsg:
-        if(!m_settings->enableLogMsgs.fatalMsg)return;
-        break;
-    }
+    if(!isLevelEnabled(type)) return;
+
+    // исключаем строки категорий, для которых уровень отключен
+    if(!CategoryTable::isEnabled(category, type)) return;
 
     //если включено отображение данной функции
-    if(!isFunctionChecked(func)) return;
+    if(!isFunctionChecked(function)) return;
 
     //формируем строки для даты времени и тп
     QString timeStr;
     if(m_settings->dispField.time){
-        if(m_settings->dispField.timeMs)
-            timeStr = date.toString("hh:mm:ss.zzz ");
-        else
-            timeStr = date.toString("hh:mm:ss ");
+        m_timeFormatter.appendTime(timeStr, timestamp, m_settings->dispField.timeMs);
+        timeStr += ' ';
+    }
+    QString dateStr;
+    if(m_settings->dispField.date){
+        m_timeFormatter.appendDate(dateStr, timestamp);
+        dateStr += ' ';
     }
-    QString dateStr = date.toString("yyyy-MM-dd ");
     QString typeStr = msgTypeToString(type) + " ";
+    QString categoryStr;
+    if(m_settings->dispField.category)
+        categoryStr = "[" + CategoryTable::name(category) + "] ";
     setMsgColorFormat(type);
 
     // добавляем текст по курсору
@@ -159,7 +145,13 @@ void ConsoleFormatter::appendFormatedLine(QTextCursor* curs, QtMsgType type, con
         {
             m_settings->textFormat.setForeground(m_settings->colors.messageSource);
             curs->setCharFormat(m_settings->textFormat);
-            curs->insertText(func + " ");
+            curs->insertText(FunctionTable::name(function) + " ");
+        }
+        if(m_settings->dispField.category)
+        {
+            m_settings->textFormat.setForeground(m_settings->colors.messageSource);
+            curs->setCharFormat(m_settings->textFormat);
+            curs->insertText(categoryStr);
         }
         m_settings->textFormat.setForeground(m_currMsgColor);
 
@@ -179,7 +171,9 @@ void ConsoleFormatter::appendFormatedLine(QTextCursor* curs, QtMsgType type, con
         if(m_settings->dispField.logLevel)
             line += typeStr;
         if(m_settings->dispField.messageSource)
-            line += func + " ";
+            line += FunctionTable::name(function) + " ";
+        if(m_settings->dispField.category)
+            line += categoryStr;
         line += ">> " + msg;
         m_settings->textFormat.setForeground(m_currMsgColor);
         if(type == QtCriticalMsg || type == QtFatalMsg)
@@ -193,26 +187,10 @@ void ConsoleFormatter::appendFormatedLine(QTextCursor* curs, QtMsgType type, con
 void ConsoleFormatter::appendSimpleLine(QTextCursor *curs, QtMsgType type, const QString &msg)
 {
     // исключаем строки если имеют уровень логирования который отключен в настройках
-    switch(type){
-    case QtInfoMsg:
-        if(!m_settings->enableLogMsgs.infoMsg)return;
-        break;
-    case QtWarningMsg:
-        if(!m_settings->enableLogMsgs.warningMsg)return;
-        break;
-    case QtDebugMsg:
-        if(!m_settings->enableLogMsgs.debugMsg)return;
-        break;
-    case QtCriticalMsg:
-        if(!m_settings->enableLogMsgs.criticalMsg)return;
-        break;
-    case QtFatalMsg:
-        if(!m_settings->enableLogMsgs.fatalMsg)return;
-        break;
-    }
+    if(!isLevelEnabled(type)) return;
 
     //если включено отображение данной функции
-    if(!isFunctionChecked("")) return;
+    if(!isFunctionChecked(0)) return;
 
     setMsgColorFormat(type);
 
@@ -228,6 +206,128 @@ void ConsoleFormatter::appendSimpleLine(QTextCursor *curs, QtMsgType type, const
     curs->endEditBlock();
 }
 
+QString ConsoleFormatter::formatLine(const LogLine &line, QVector<QTextLayout::FormatRange> *formats,
+                                    int *messageStart)
+{
+    setMsgColorFormat(line.type);
+    bool highlight = line.type == QtCriticalMsg || line.type == QtFatalMsg;
+    QString text;
+    // добавляет поле и, при расширенной раскраске, его цвет
+    auto appendField = [&](const QString& field, const QColor& color){
+        if(formats && m_settings->extendedColors){
+            QTextLayout::FormatRange range;
+            range.start = text.size();
+            range.length = field.size();
+            range.format.setForeground(color);
+            formats->append(range);
+        }
+        text += field;
+    };
+
+    if(!line.only_message)
+    {
+        if(m_settings->dispField.date){
+            QString dateStr;
+            m_timeFormatter.appendDate(dateStr, line.timestamp);
+            appendField(dateStr + ' ', m_settings->colors.date);
+        }
+        if(m_settings->dispField.time){
+            QString timeStr;
+            m_timeFormatter.appendTime(timeStr, line.timestamp, m_settings->dispField.timeMs);
+            appendField(timeStr + ' ', m_settings->colors.time);
+        }
+        if(m_settings->dispField.logLevel)
+            appendField(msgTypeToString(line.type) + ' ', m_settings->colors.logLevel);
+        if(m_settings->dispField.messageSource)
+            appendField(FunctionTable::name(line.functionId) + ' ', m_settings->colors.messageSource);
+        if(m_settings->dispField.category)
+            appendField('[' + CategoryTable::name(line.categoryId) + "] ", m_settings->colors.messageSource);
+    }
+
+    // основное сообщение (без расширенной раскраски - вся строка) цветом уровня логирования
+    int colorStart = (m_settings->extendedColors || !formats) ? text.size() : 0;
+    text += line.only_message ? line.message : ">> " + line.message;
+    if(messageStart)
+        *messageStart = text.size() - line.message.size();
+    if(formats){
+        QTextLayout::FormatRange range;
+        range.start = colorStart;
+        range.length = text.size() - colorStart;
+        range.format.setForeground(m_currMsgColor);
+        if(highlight)
+            range.format.setBackground(m_currMsgBgColor);
+        formats->append(range);
+    }
+    return text;
+}
+
+bool ConsoleFormatter::isLineVisible(QtMsgType type, quint32 function, quint32 category) const
+{
+    return isLevelEnabled(type)
+           && CategoryTable::isEnabled(category, type)
+           && isFunctionChecked(function);
+}
+
+bool ConsoleFormatter::timeWindow(qint64 &from, qint64 &to) const
+{
+    switch(m_settings->timeFilter){
+    case ConsoleSettings::TimeFilterRange:
+        from = m_settings->filterStartTime;
+        to = m_settings->filterEndTime;
+        return true;
+    case ConsoleSettings::TimeFilterLastMinutes:
+        from = Time::now() - (qint64)m_settings->filterLastMinutes * 60 * 1000;
+        to = std::numeric_limits<qint64>::max();
+        return true;
+    }
+    from = std::numeric_limits<qint64>::min();
+    to = std::numeric_limits<qint64>::max();
+    return false;
+}
+
+void ConsoleFormatter::appendVisibleRows(const LogHistory &history, qint64 from, qint64 to,
+                                         qint64 timeFrom, qint64 timeTo, QVector<qint64> &rows) const
+{
+    quint8 levels = 0;
+    for(QtMsgType type : {QtDebugMsg, QtWarningMsg, QtCriticalMsg, QtFatalMsg, QtInfoMsg})
+        if(isLevelEnabled(type))
+            levels |= levelBit(type);
+
+    quint8 pass[filter_block_size];
+    for(qint64 i = from; i < to; )
+    {
+        int n = qMin(history.segment(i, to), filter_block_size);
+        const quint8* types = history.types(i);
+        const qint64* times = history.timestamps(i);
+        for(int k = 0; k < n; k++)
+            pass[k] = ((levels >> types[k]) & 1) & (times[k] >= timeFrom) & (times[k] <= timeTo);
+
+        const quint32* functions = history.functionIds(i);
+        const quint32* categories = history.categoryIds(i);
+        for(int k = 0; k < n; k++)
+            if(pass[k] && isFunctionChecked(functions[k]) && CategoryTable::isEnabled(categories[k], QtMsgType(types[k])))
+                rows.append(i + k);
+        i += n;
+    }
+}
+
+bool ConsoleFormatter::isLevelEnabled(QtMsgType type) const
+{
+    switch(type){
+    case QtInfoMsg:
+        return m_settings->enableLogMsgs.infoMsg;
+    case QtWarningMsg:
+        return m_settings->enableLogMsgs.warningMsg;
+    case QtDebugMsg:
+        return m_settings->enableLogMsgs.debugMsg;
+    case QtCriticalMsg:
+        return m_settings->enableLogMsgs.criticalMsg;
+    case QtFatalMsg:
+        return m_settings->enableLogMsgs.fatalMsg;
+    }
+    return true;
+}
+
 void ConsoleFormatter::setMsgColorFormat(QtMsgType type)
 {
     switch(type)
@@ -304,40 +404,6 @@ void ConsoleFormatter::setMsgColorFormat(const QString &typeStr)
     }
 }
 
-bool ConsoleFormatter::isFunctionChecked(const QString &func)
-{
-    //модель содержит список в виде древа включенных и выключнных функций
-    QStandardItemModel* model = m_settings->functions;
-    if(!model) return true;
-    const QStandardItem* item = model->invisibleRootItem();
-    const QStringList list = func.split("::");
-
-    for(int i = 0; i<list.size(); i++){
-        QStandardItem* child;
-        int itemCount = item->rowCount()-1;
-        for(int j = 0; j<=itemCount; j++){
-            child = item->child(j);
-            if(!child)continue;
-            if(list[i] == child->text()){
-                int state = child->data(Qt::UserRole).toInt();
-                if(state == Qt::CheckState::Checked)
-                    return true;
-                if(state == Qt::CheckState::Unchecked)
-                    return false;
-                if(state == Qt::CheckState::PartiallyChecked){
-                    item = child;
-                     break;
-                }
-            }
-            if(j==itemCount ){
-                // если функция не найдена
-                return true; // считаем что она отмечена и отображение включено
-            }
-        }
-    }
-    return true;
-}
-
 
 
 
@@ -360,15 +426,21 @@ LogConsoleWidget::LogConsoleWidget(QWidget *parent, Qt::WindowFlags f) :
     m_settings.dispField.time = true;
     m_settings.dispField.timeMs = true;
     m_settings.dispField.messageSource = true;
+    m_settings.dispField.category = false;
     m_settings.enableLogMsgs.criticalMsg = true;
     m_settings.enableLogMsgs.debugMsg = true;
     m_settings.enableLogMsgs.fatalMsg = true;
     m_settings.enableLogMsgs.infoMsg = true;
     m_settings.enableLogMsgs.warningMsg = true;
-    m_settings.functions = nullptr;
     m_settings.extendedColors = true;
     m_settings.textFormat.setFontFamily("Consolas");
     m_settings.textFormat.setFontPointSize(14);
+    m_settings.historyMaxLines = 1000000;
+    m_settings.historyMaxMegabytes = 512;
+    m_settings.timeFilter = ConsoleSettings::TimeFilterOff;
+    m_settings.filterStartTime = 0;
+    m_settings.filterEndTime = 0;
+    m_settings.filterLastMinutes = 10;
 
     m_settings.colors.date = QColor(0, 0x6e, 0xa5);                 //"#0000ff"
     m_settings.colors.time = QColor(0x00, 0x88, 0xcc);              //"#aa00ff"
@@ -390,16 +462,7 @@ LogConsoleWidget::LogConsoleWidget(QWidget *parent, Qt::WindowFlags f) :
 
     //подключаем кнопку к включению и отключению LineWrapMode
     connect(ui->checkBox_lineWrap, &QCheckBox::stateChanged, this, [=](bool wrap) {
-        if(wrap)
-        {
-            //ui->textEdit->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
-            ui->textEdit->setLineWrapMode(QTextEdit::LineWrapMode::WidgetWidth);
-        }
-        else
-        {
-            //ui->textEdit->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-            ui->textEdit->setLineWrapMode(QTextEdit::LineWrapMode::NoWrap);
-        }
+        ui->logView->setLineWrap(wrap);
     });
 
     connect(ui->checkBoxOnTopHint, &QCheckBox::stateChanged, this, [this](bool onTop) {
@@ -437,11 +500,10 @@ LogConsoleWidget::LogConsoleWidget(QWidget *parent, Qt::WindowFlags f) :
 
 
 
-    //подключаем кнопку очистки консоли к очистке истории и textEdit
+    //подключаем кнопку очистки консоли к очистке истории и отображения
     connect(ui->pushButton_clear, &QPushButton::clicked, this, [&](){
         QMutexLocker locker(&m_mutex);
-        ui->textEdit->clear();
-        m_history.clear();
+        clearHistory();
     });
 
 
@@ -458,13 +520,38 @@ LogConsoleWidget::LogConsoleWidget(QWidget *parent, Qt::WindowFlags f) :
         optWidget->deleteLater();
     });
 
-    // настройка testEdit
-    ui->textEdit->setReadOnly(true);
-    ui->textEdit->document()->setUndoRedoEnabled(false);
-    // ui->textEdit->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    ui->textEdit->setLineWrapMode(QTextEdit::LineWrapMode::NoWrap);
-    ui->textEdit->setWordWrapMode(QTextOption::WordWrap);
-    ui->textEdit->setAlignment(Qt::AlignLeft);
+    // строки из postLines(..) и postBatch(..) добавляются кадрами
+    m_frameTimer = new QTimer(this);
+    m_frameTimer->setInterval(default_frame_interval);
+    connect(m_frameTimer, &QTimer::timeout, this, &LogConsoleWidget::renderFrame);
+
+    // свой пул для фоновой работы консоли (разбор файлов, фильтрация, поиск, копирование):
+    // глобальный пул приложения не ограничивается и не занимается
+    m_threadPool = new QThreadPool(this);
+    m_threadPool->setMaxThreadCount(QThread::idealThreadCount());
+
+    // список отображаемых строк пересчитывается в фоне
+    m_rowsWatcher = new QFutureWatcher<QVector<qint64>>(this);
+    connect(m_rowsWatcher, &QFutureWatcher<QVector<qint64>>::finished, this, &LogConsoleWidget::applyRebuiltRows);
+
+    // старые строки загружаемого файла разбираются в фоне и добавляются в начало истории
+    m_loadWatcher = new QFutureWatcher<LogHistory::Batch>(this);
+    connect(m_loadWatcher, &QFutureWatcher<LogHistory::Batch>::resultReadyAt, this, &LogConsoleWidget::takeLoadedBatches);
+    connect(m_loadWatcher, &QFutureWatcher<LogHistory::Batch>::finished, this, &LogConsoleWidget::finishLoading);
+    // переход к строке файла: индекс обновляется в фоне с тем же индикатором
+    m_indexWatcher = new QFutureWatcher<LogFileIndex::Window>(this);
+    connect(m_indexWatcher, &QFutureWatcher<LogFileIndex::Window>::progressRangeChanged, ui->progressBar_load, &QProgressBar::setRange);
+    connect(m_indexWatcher, &QFutureWatcher<LogFileIndex::Window>::progressValueChanged, ui->progressBar_load, &QProgressBar::setValue);
+    connect(m_indexWatcher, &QFutureWatcher<LogFileIndex::Window>::finished, this, &LogConsoleWidget::showIndexedLines);
+    connect(ui->pushButton_loadCancel, &QPushButton::clicked, this, &LogConsoleWidget::cancelLoading);
+    ui->progressBar_load->hide();
+    ui->pushButton_loadCancel->hide();
+
+    // отображение рисует строки напрямую из истории
+    applyHistoryLimits();
+    ui->logView->setSource(&m_history, m_formatter);
+    ui->logView->setThreadPool(m_threadPool);
+    ui->logView->setTextFont(m_settings.textFormat.font());
 
     //подключаем сигналы добавления строки
     connect(this, QOverload<QtMsgType, QDateTime, QString, const QString>::of(&LogConsoleWidget::sigAppendFormatedLine),
@@ -474,6 +561,38 @@ LogConsoleWidget::LogConsoleWidget(QWidget *parent, Qt::WindowFlags f) :
             this, QOverload<const QString&>::of(&LogConsoleWidget::appendFormatedLine),
             Qt::QueuedConnection);
 
+    // поиск идет в фоне, найденные строки подсвечиваются в отображении
+    m_search = new LogSearch(&m_history, &m_historyLock, m_threadPool, this);
+    connect(m_search, &LogSearch::matchesChanged, this, &LogConsoleWidget::updateSearchCount);
+    connect(m_search, &LogSearch::finished, this, &LogConsoleWidget::updateSearchCount);
+    m_follower = new LogFileFollower(this, m_threadPool, this);
+    // отслеживаемый файл усечен или заменен при ротации: прежние строки к нему больше не относятся
+    connect(m_follower, &LogFileFollower::fileReplaced, this, [this](){
+        QMutexLocker locker(&m_mutex);
+        clearHistory();
+        m_loadedFileSize = 0;
+    });
+    connect(ui->lineEdit_search, &QLineEdit::textChanged, this, [this](){
+        QMutexLocker locker(&m_mutex);
+        startSearch();
+    });
+    connect(ui->checkBox_searchCase, &QCheckBox::toggled, this, [this](){
+        QMutexLocker locker(&m_mutex);
+        startSearch();
+    });
+    connect(ui->lineEdit_search, &QLineEdit::returnPressed, this, [this](){ jumpToMatch(true); });
+    connect(ui->pushButton_searchNext, &QPushButton::clicked, this, [this](){ jumpToMatch(true); });
+    connect(ui->pushButton_searchPrev, &QPushButton::clicked, this, [this](){ jumpToMatch(false); });
+    QShortcut* findShortcut = new QShortcut(QKeySequence::Find, this, nullptr, nullptr, Qt::WidgetWithChildrenShortcut);
+    connect(findShortcut, &QShortcut::activated, this, [this](){
+        ui->lineEdit_search->setFocus();
+        ui->lineEdit_search->selectAll();
+    });
+    QShortcut* nextShortcut = new QShortcut(QKeySequence::FindNext, this, nullptr, nullptr, Qt::WidgetWithChildrenShortcut);
+    connect(nextShortcut, &QShortcut::activated, this, [this](){ jumpToMatch(true); });
+    QShortcut* prevShortcut = new QShortcut(QKeySequence::FindPrevious, this, nullptr, nullptr, Qt::WidgetWithChildrenShortcut);
+    connect(prevShortcut, &QShortcut::activated, this, [this](){ jumpToMatch(false); });
+
     //создаю виджет для изменяющий правила сортировки
     m_FuncSelector = new FunctionSelectorWidget(this);
     m_FuncSelector->resize(300, 350);
@@ -484,6 +603,7 @@ LogConsoleWidget::LogConsoleWidget(QWidget *parent, Qt::WindowFlags f) :
         pos = ui->FilterButton->mapToGlobal(pos);
         m_FuncSelector->move(pos);
         m_FuncSelector->sortItems();
+        m_FuncSelector->updateTimeFilter();
         //m_FuncSelector->show();
         m_FuncSelector->exec();
         updateContent();
@@ -491,8 +611,7 @@ LogConsoleWidget::LogConsoleWidget(QWidget *parent, Qt::WindowFlags f) :
     });
     //подключаем кнопку прокрутки консоли в самый низ
     connect(ui->pushButton_GoDown, &QPushButton::clicked, this, [=]() {
-        QScrollBar* scroll = ui->textEdit->verticalScrollBar();
-        scroll->setValue(scroll->maximum());
+        ui->logView->scrollToBottom();
     });
 
     QIcon icon1(":/Console/resources/trash_bin_icon.png");
@@ -505,10 +624,20 @@ LogConsoleWidget::LogConsoleWidget(QWidget *parent, Qt::WindowFlags f) :
 
 LogConsoleWidget::~LogConsoleWidget()
 {
+    // чтение отслеживаемого файла отправляет строки в консоль
+    m_follower->stop();
+    // фоновый пересчет читает историю - дожидаемся его до разрушения
+    m_rowsGeneration++;
+    m_rowsWatcher->cancel();
+    m_rowsWatcher->waitForFinished();
+    m_loadWatcher->cancel();
+    m_loadWatcher->waitForFinished();
+    m_indexWatcher->cancel();
+    m_indexWatcher->waitForFinished();
+    // поиск тоже читает историю, а дочерние объекты удаляются уже после нее
+    delete m_search;
     delete ui;
     delete m_formatter;
-    if(m_settings.functions)
-        delete m_settings.functions;
 }
 
 bool LogConsoleWidget::saveSettings(QString path)
@@ -533,6 +662,7 @@ bool LogConsoleWidget::saveSettings(QString path)
     saving.setValue("timeMilliseconds", QVariant((bool)m_settings.dispField.timeMs));
     saving.setValue("logLevel", QVariant((bool)m_settings.dispField.logLevel));
     saving.setValue("messageSource", QVariant((bool)m_settings.dispField.messageSource));
+    saving.setValue("category", QVariant((bool)m_settings.dispField.category));
     saving.endGroup();
 
     saving.beginGroup("ConsoleColors");
@@ -563,11 +693,28 @@ bool LogConsoleWidget::saveSettings(QString path)
     saving.setValue("FontName", m_settings.textFormat.fontFamily());
     saving.setValue("FontSize", m_settings.textFormat.fontPointSize());
 
+    saving.beginGroup("History");
+    saving.setValue("maxLines", m_settings.historyMaxLines);
+    saving.setValue("maxMegabytes", m_settings.historyMaxMegabytes);
+    saving.endGroup();
+
+    saving.beginGroup("TimeFilter");
+    saving.setValue("mode", m_settings.timeFilter);
+    saving.setValue("start", m_settings.filterStartTime);
+    saving.setValue("end", m_settings.filterEndTime);
+    saving.setValue("lastMinutes", m_settings.filterLastMinutes);
+    saving.endGroup();
+
+    // маски разрешенных уровней категорий (биты 1 << QtMsgType)
+    saving.beginGroup("CategoryLevels");
+    for(quint32 id = 0; id < CategoryTable::count(); id++)
+        saving.setValue(CategoryTable::name(id), QVariant((uint)CategoryTable::mask(id)));
+    saving.endGroup();
 
     saving.beginGroup("FunctionFilter");
-    QVector<QPair<QString, bool>> vector = m_FuncSelector->convertToVector();
+    QVector<QPair<quint32, bool>> vector = m_FuncSelector->convertToVector();
     for(const auto &pair : std::as_const(vector))
-        saving.setValue(pair.first, QVariant((bool)pair.second));
+        saving.setValue(FunctionTable::name(pair.first), QVariant((bool)pair.second));
     saving.endGroup();
 
     saving.sync();
@@ -599,6 +746,7 @@ bool LogConsoleWidget::loadSettings(QString path)
     m_settings.dispField.timeMs = saving.value("timeMilliseconds").toBool();
     m_settings.dispField.logLevel = saving.value("logLevel").toBool();
     m_settings.dispField.messageSource = saving.value("messageSource").toBool();
+    m_settings.dispField.category = saving.value("category").toBool();
     saving.endGroup();
 
     saving.beginGroup("ConsoleColors");
@@ -648,24 +796,41 @@ bool LogConsoleWidget::loadSettings(QString path)
     m_settings.textFormat.setFontFamily(saving.value("FontName").toString());
     m_settings.textFormat.setFontPointSize(saving.value("FontSize").toInt());
 
+    // в старых файлах настроек группы нет - остаются текущие ограничения
+    saving.beginGroup("History");
+    m_settings.historyMaxLines = saving.value("maxLines", m_settings.historyMaxLines).toInt();
+    m_settings.historyMaxMegabytes = saving.value("maxMegabytes", m_settings.historyMaxMegabytes).toInt();
+    saving.endGroup();
+    applyHistoryLimits();
+    removeEvictedLines();
+
+    saving.beginGroup("TimeFilter");
+    m_settings.timeFilter = saving.value("mode", m_settings.timeFilter).toInt();
+    m_settings.filterStartTime = saving.value("start", m_settings.filterStartTime).toLongLong();
+    m_settings.filterEndTime = saving.value("end", m_settings.filterEndTime).toLongLong();
+    m_settings.filterLastMinutes = saving.value("lastMinutes", m_settings.filterLastMinutes).toInt();
+    saving.endGroup();
+
+    saving.beginGroup("CategoryLevels");
+    const QStringList categories = saving.childKeys();
+    for(const auto &category : categories)
+        CategoryTable::setMask(CategoryTable::intern(category), (quint8)saving.value(category).toUInt());
+    saving.endGroup();
 
     saving.beginGroup("FunctionFilter");
     QStringList list = saving.childKeys();
     for(const auto &keyName : std::as_const(list)){
         if(keyName.isEmpty())continue;
         bool st = saving.value(keyName).toBool();
-        m_FuncSelector->addFunction(keyName);
-        m_FuncSelector->setCheckStateFunction(keyName, st);
+        quint32 id = FunctionTable::intern(keyName);
+        m_FuncSelector->addFunction(id);
+        m_FuncSelector->setCheckStateFunction(id, st);
     }
     saving.endGroup();
 
     m_FuncSelector->updateEnablesLogMsgs();
 
-    //###
-    QStandardItemModel* mod = m_FuncSelector->convertToStandardItemModel();
-    if(m_settings.functions)
-        delete m_settings.functions;
-    m_settings.functions = mod;
+    m_settings.functions = m_FuncSelector->functionFilter();
 
     return false;
 }
@@ -675,119 +840,222 @@ bool LogConsoleWidget::loadLogsHistory(QString path)
     if(QFileInfo::exists(path) && (path.endsWith(".txt") || path.endsWith(".log")))
     {
         m_logFilePath = path;
-        QFile f(path);
-        if(!f.open(QFile::ReadOnly | QFile::Text)) return true;
+        // файл отображен в память, пока его разбирают задачи догрузки
+        QSharedPointer<LogFileReader> reader(new LogFileReader(path));
+        if(!reader->open()) return true;
 
-        QTextStream in(&f);
-
-        //QElapsedTimer timer;
-        //timer.start();
-        //формируем блоки строк
-        QList<QStringList> stringListBlocks;
-        bool at_end = false;
-        while(!at_end)
+        QMutexLocker locker(&m_mutex);
+        // строки прежнего файла не должны попасть в новую историю
+        stopIndexing();
+        m_follower->stop();
+        clearHistory();
+        m_loadedFileSize = reader->size();
+
+        // последние строки разбираются сразу и показываются внизу окна
+        qint64 tail = reader->tailStart(load_tail_lines);
+        LogHistory::Batch batch = LogFileReader::parseLines(reader->data() + tail, reader->size() - tail);
+        qint64 first;
         {
-            QStringList block;
-            QString line;
-            for(int i = 0; i<line_count; i++){
-                if(in.atEnd()){
-                    at_end = true;
-                    break;
-                }
-                line = in.readLine();
-                block.append(line);
-            }
-            if(block.size())
-                stringListBlocks.append(std::move(block));
-        }
-        //float t0 = timer.nsecsElapsed()/1000;
-        //std::cout << "create  QVector<QStringList> " << t0/1000 << " ms;"<< std::endl;
-        //float t1, t2;
-
-        QList<QVector<LogLine>> Blocks;
-        bool useConcurrent = (stringListBlocks.size()*line_count) >= 1500 ; // если больше 1500 строк используем многопоток (небольшой прирост производительности)
-        if(useConcurrent){
-            //timer.restart();
-            QThreadPool *pool = QThreadPool::globalInstance();
-            int previousThreadCount = pool->maxThreadCount();
-            pool->setMaxThreadCount(3);
-            QFuture<QPair<QVector<LogLine>, QStringList>> future;
-            future = QtConcurrent::mapped(stringListBlocks, ConsoleFormatter::stringList2LogLines);
-            // Ждем завершения выполнения задачи
-            future.waitForFinished();
-            pool->setMaxThreadCount(previousThreadCount);
-            //t1 = timer.nsecsElapsed()/1000;
-            //std::cout << "translate stringList to LogLines " << t1/1000 << " ms;"<< std::endl;
-
-            //timer.restart();
-            //добавляем функции в m_FuncSelector
-            for(int i=0; i<future.resultCount(); i++){
-                const QPair<QVector<LogLine>, QStringList>& result = future.resultAt(i);
-                for(auto func : result.second)
-                    m_FuncSelector->addFunction(std::move(func));
-                Blocks.append(std::move(result.first));
-            }
-            //t2 = timer.nsecsElapsed()/1000;
-            //std::cout << "add Functions to selector " << t2/1000 << " ms;" << std::endl;
+            QWriteLocker historyLocker(&m_historyLock);
+            // номера перед последними строками остаются старым строкам: их не больше, чем байт
+            m_history.reserveFront(tail - reader->dataBegin());
+            first = m_history.endIndex();
+            m_history.append(batch);
         }
-        else
-        {
-            //timer.restart();
-            QStringList Functions;
-            for(const auto &stringBlock : std::as_const(stringListBlocks)){
-                auto pair = m_formatter->stringList2LogLines(stringBlock);
-                Blocks.append(std::move(pair.first));
-                Functions.append(std::move(pair.second));
-            }
-            //t1 = timer.nsecsElapsed()/1000;
-            //std::cout << "translate stringList to LogLines " << t1/1000 << " ms;"<< std::endl;
+        for(quint32 func : std::as_const(batch.functions))
+            m_FuncSelector->addFunction(func);
+        removeEvictedLines();
+        m_search->scanAppended();
+        //отображение форматирует только видимые строки, поэтому достаточно добавить индексы
+        ui->logView->appendRows(visibleRows(first, m_history.endIndex()));
+        ui->logView->scrollToBottom();
+        // дописываемые строки добавляются в конец, пока старые догружаются в начало
+        if(m_followLogFile)
+            m_follower->start(path, m_loadedFileSize);
+
+        // остальное - частями от конца к началу файла, параллельно. Частей в несколько раз больше,
+        // чем потоков, чтобы освободившиеся потоки забирали оставшиеся, но каждая - не меньше мегабайта
+        qint64 rangeSize = qBound(load_range_min,
+                                  (tail - reader->dataBegin()) / (m_threadPool->maxThreadCount() * load_ranges_per_thread),
+                                  load_range_max);
+        QVector<LogFileReader::Range> ranges = reader->splitRanges(reader->dataBegin(), tail, rangeSize);
+        if(ranges.isEmpty()) return false;
+        std::reverse(ranges.begin(), ranges.end());
+        m_loadNext = 0;
+        m_loadCount = ranges.size();
+        ui->progressBar_load->setRange(0, m_loadCount);
+        ui->progressBar_load->setValue(0);
+        ui->progressBar_load->show();
+        ui->pushButton_loadCancel->show();
+        m_loadWatcher->setFuture(LogFileReader::parseRanges(reader, ranges, m_threadPool));
+        return false;
+    }
 
-            //timer.restart();
-            for(const auto &func : Functions)
-                m_FuncSelector->addFunction(func);
-            //t2 = timer.nsecsElapsed()/1000;
-            //std::cout << "add Functions to selector " << t2/1000 << " ms;"<< std::endl;
-        }
+    return true;
+}
 
-        //добавляем строки в историю
-        //timer.restart();
-        for(const auto &block : Blocks)
-            for(const auto &line : block)
-                m_history.append(line);
-        //float t3 = timer.nsecsElapsed()/1000;
-        //std::cout << "add LogLines to history " << t3/1000 << " ms;"<< std::endl;
-
-        QList<QTextDocumentFragment> docFragments;
-        //timer.restart();
-        //преобразование блоков текста в документ
-        for(const auto &block : Blocks){
-            QTextDocument* doc = m_formatter->formatBlockToDoc(block);
-            QTextDocumentFragment fr(doc);
-            docFragments.append(std::move(fr));
-            delete doc;
-        }
+bool LogConsoleWidget::loadLogsAtLine(QString path, qint64 line)
+{
+    return loadIndexedLines(path, false, line);
+}
 
-        //float t4 = timer.nsecsElapsed()/1000;
-        //std::cout << "translate LogLinesBlocks to docFrag " << t4/1000 << " ms;"<< std::endl;
+bool LogConsoleWidget::loadLogsAtTime(QString path, const QDateTime &time)
+{
+    return loadIndexedLines(path, true, Time::fromDateTime(time));
+}
 
+bool LogConsoleWidget::loadIndexedLines(const QString &path, bool byTime, qint64 target)
+{
+    if(!QFileInfo::exists(path) || !(path.endsWith(".txt") || path.endsWith(".log"))) return true;
+    // прежняя загрузка заменяется новой
+    stopIndexing();
+    cancelLoading();
+    m_indexPath = path;
+    m_indexByTime = byTime;
+    m_indexTarget = target;
+    ui->progressBar_load->setRange(0, 0);
+    ui->progressBar_load->show();
+    ui->pushButton_loadCancel->show();
+    m_indexWatcher->setFuture(LogFileIndex::loadWindow(path, byTime, target, seek_window_chunks, m_threadPool));
+    return false;
+}
+
+void LogConsoleWidget::showIndexedLines()
+{
+    // отмененная загрузка уже убрала индикатор
+    if(m_indexWatcher->isCanceled() || m_indexWatcher->future().resultCount() == 0) return;
+    LogFileIndex::Window window = m_indexWatcher->result();
+    m_indexWatcher->setFuture(QFuture<LogFileIndex::Window>());
+    ui->progressBar_load->hide();
+    ui->pushButton_loadCancel->hide();
+    if(!window.loaded) return;
 
-        //timer.restart();
-        //добавление документов
-        for(const auto &fragment : docFragments){
-            appendDocumentFragment(fragment);
+    QMutexLocker locker(&m_mutex);
+    m_logFilePath = m_indexPath;
+    m_follower->stop();
+    clearHistory();
+    // слежение дописывает строки под загруженными - только если окно заканчивается концом файла.
+    // Для окна из середины файла оно не начинается: включение слежения загрузит конец файла
+    bool tail = window.end >= window.fileSize;
+    m_loadedFileSize = tail ? window.fileSize : -1;
+    if(m_followLogFile && tail)
+        m_follower->start(m_logFilePath, m_loadedFileSize);
+    qint64 first;
+    {
+        QWriteLocker historyLocker(&m_historyLock);
+        first = m_history.endIndex();
+        m_history.append(window.batch);
+    }
+    for(quint32 func : std::as_const(window.batch.functions))
+        m_FuncSelector->addFunction(func);
+    removeEvictedLines();
+    m_search->scanAppended();
+    ui->logView->appendRows(visibleRows(m_history.firstIndex(), m_history.endIndex()));
+    if(m_history.isEmpty()) return;
+
+    qint64 line = m_history.endIndex() - 1;
+    if(!m_indexByTime)
+        line = first + (m_indexTarget - window.firstLine);
+    else
+    {
+        qint64 from = m_history.firstIndex(), to = m_history.endIndex();
+        m_history.timeRange(m_indexTarget, std::numeric_limits<qint64>::max(), from, to);
+        while(from < to && m_history.timestamp(from) < m_indexTarget)
+            from++;
+        if(from < to)
+            line = from;
+    }
+    showHistoryLine(qBound(m_history.firstIndex(), line, m_history.endIndex() - 1));
+}
+
+void LogConsoleWidget::stopIndexing()
+{
+    if(!m_indexWatcher->isRunning()) return;
+    m_indexWatcher->cancel();
+    ui->progressBar_load->hide();
+    ui->pushButton_loadCancel->hide();
+}
+
+void LogConsoleWidget::showHistoryLine(qint64 index)
+{
+    int row = ui->logView->rowAtOrAfter(index);
+    ui->logView->scrollToRow(qMin(row, ui->logView->rowCount() - 1));
+}
+
+void LogConsoleWidget::setFollowLogFile(bool follow)
+{
+    if(m_followLogFile == follow) return;
+    m_followLogFile = follow;
+    if(!follow){
+        // при повторном включении чтение продолжится с того же места
+        if(m_follower->isActive()){
+            m_follower->stop();
+            m_loadedFileSize = m_follower->readOffset();
         }
-        //float t5 = timer.nsecsElapsed()/1000;
-        //std::cout << "add docFragments to textEdit " << t5/1000 << " ms;"<< std::endl;
-        //std::cout << "total load Time " << (t0+t1+t2+t3+t4+t5)/1000 << " ms;"<< std::endl;
+        return;
+    }
+    if(m_loadedFileSize < 0)
+        loadLogsHistory(m_logFilePath);
+    else
+        m_follower->start(m_logFilePath, m_loadedFileSize);
+}
+
+void LogConsoleWidget::cancelLoading()
+{
+    stopIndexing();
+    if(!isLoading()) return;
+    m_loadWatcher->cancel();
+    finishLoading();
+}
 
-        f.close();
+bool LogConsoleWidget::isLoading() const
+{
+    return m_loadNext < m_loadCount;
+}
 
-        int val = ui->textEdit->verticalScrollBar()->maximum();
-        ui->textEdit->verticalScrollBar()->setValue(val);
-        return false;
+void LogConsoleWidget::takeLoadedBatches()
+{
+    if(m_loadWatcher->isCanceled()) return;
+    QMutexLocker locker(&m_mutex);
+    // части готовы в любом порядке, а в историю добавляются строго от конца файла к началу
+    QFuture<LogHistory::Batch> future = m_loadWatcher->future();
+    while(m_loadNext < m_loadCount && future.isResultReadyAt(m_loadNext))
+    {
+        const LogHistory::Batch batch = future.resultAt(m_loadNext++);
+        qint64 end = m_history.firstIndex();
+        int added;
+        {
+            QWriteLocker historyLocker(&m_historyLock);
+            added = m_history.prepend(batch);
+        }
+        if(added == batch.lines.size()){
+            for(quint32 func : batch.functions)
+                m_FuncSelector->addFunction(func);
+        }
+        else{
+            for(int i = batch.lines.size() - added; i < batch.lines.size(); i++)
+                m_FuncSelector->addFunction(batch.lines.at(i).functionId);
+        }
+        m_search->scanPrepended();
+        // отображение остается на тех же строках
+        ui->logView->prependRows(visibleRows(m_history.firstIndex(), end));
+        // история заполнена до ограничений: более старые строки все равно были бы вытеснены
+        if(added < batch.lines.size()){
+            m_loadWatcher->cancel();
+            finishLoading();
+            return;
+        }
     }
+    ui->progressBar_load->setValue(m_loadNext);
+}
 
-    return true;
+void LogConsoleWidget::finishLoading()
+{
+    m_loadNext = m_loadCount = 0;
+    // разобранные части хранит future: отпускаем их (текст уже разделяется с историей)
+    m_loadWatcher->setFuture(QFuture<LogHistory::Batch>());
+    ui->progressBar_load->hide();
+    ui->pushButton_loadCancel->hide();
 }
 
 QString LogConsoleWidget::getLogFilePath()
@@ -809,89 +1077,182 @@ void LogConsoleWidget::setLogFilePath(const QString &path)
 
 void LogConsoleWidget::appendFormatedLine(const QString &line)
 {
+    postLines({LogLine(line)});
+}
+
+void LogConsoleWidget::appendFormatedLine(QtMsgType type, QDateTime date, QString func, const QString msg)
+{
+    postLines({LogLine(type, date, func, msg)});
+}
+
+void LogConsoleWidget::appendLines(const QVector<LogLine> &lines)
+{
+    if(lines.isEmpty()) return;
     QMutexLocker locker(&m_mutex);
-    // Сохраняем текущую позицию скролла
-    QScrollBar* scroll = ui->textEdit->verticalScrollBar();
-    int scrollValue = scroll->value();
-    bool atBottom = (scroll->maximum() - scrollValue <= 50);
+    qint64 first = m_history.endIndex();
+    storeLines(lines.constData(), lines.size());
+    removeEvictedLines();
+    m_search->scanAppended();
 
+    // отображение само держит позицию прокрутки (прилипание к концу)
+    ui->logView->appendRows(visibleRows(first, m_history.endIndex()));
+}
 
-    ui->textEdit->setUpdatesEnabled(false);
+void LogConsoleWidget::postLines(const QVector<LogLine> &lines)
+{
+    if(lines.isEmpty()) return;
+    QMutexLocker locker(&m_pendingMutex);
+    m_pendingLines.append(lines);
+    scheduleFrame();
+}
 
-    QTextDocument* doc = ui->textEdit->document();
-    QTextCursor curs(doc);
-    curs.movePosition(QTextCursor::End);
+void LogConsoleWidget::postBatch(const LogHistory::Batch &batch)
+{
+    if(batch.lines.isEmpty()) return;
+    QMutexLocker locker(&m_pendingMutex);
+    m_pendingBatches.append(batch);
+    scheduleFrame();
+}
 
-    LogLine logLine(line);
-    emit appendedNewLine(logLine);
-    m_history.append(logLine);
-    m_FuncSelector->addFunction(logLine.functionStr);
-    m_formatter->appendFormatedLine(&curs, line);
+void LogConsoleWidget::scheduleFrame()
+{
+    // таймер кадров запускается один раз и работает, пока есть что добавлять
+    if(m_frameScheduled) return;
+    m_frameScheduled = true;
+    QMetaObject::invokeMethod(m_frameTimer, QOverload<>::of(&QTimer::start), Qt::QueuedConnection);
+}
 
-    ui->textEdit->setUpdatesEnabled(true);
+void LogConsoleWidget::setTimeFilter(const QDateTime &from, const QDateTime &to)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_settings.timeFilter = ConsoleSettings::TimeFilterRange;
+        m_settings.filterStartTime = Time::fromDateTime(from);
+        m_settings.filterEndTime = Time::fromDateTime(to);
+    }
+    updateContent();
+}
 
-    // Переносим позицию скролла если окно отображения в низу консоли (эффект прилипания)
-    if(!atBottom)
-        scroll->setValue(scrollValue);
-    else
-        scroll->setValue(scroll->maximum());
+void LogConsoleWidget::setTimeFilterLastMinutes(int minutes)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_settings.timeFilter = ConsoleSettings::TimeFilterLastMinutes;
+        m_settings.filterLastMinutes = qMax(1, minutes);
+    }
+    updateContent();
 }
 
-void LogConsoleWidget::appendFormatedLine(QtMsgType type, QDateTime date, QString func, const QString msg)
+void LogConsoleWidget::clearTimeFilter()
 {
-    QMutexLocker locker(&m_mutex);
-    // Сохраняем текущую позицию скролла
-    QScrollBar* scroll = ui->textEdit->verticalScrollBar();
-    int scrollValue = scroll->value();
-    bool atBottom = (scroll->maximum() - scrollValue <= 50);
+    {
+        QMutexLocker locker(&m_mutex);
+        m_settings.timeFilter = ConsoleSettings::TimeFilterOff;
+    }
+    updateContent();
+}
 
+void LogConsoleWidget::setFrameInterval(int msec)
+{
+    m_frameTimer->setInterval(qMax(1, msec));
+}
 
-    ui->textEdit->setUpdatesEnabled(false);
+int LogConsoleWidget::frameInterval() const
+{
+    return m_frameTimer->interval();
+}
 
-    QTextDocument* doc = ui->textEdit->document();
-    QTextCursor curs(doc);
-    curs.movePosition(QTextCursor::End);
+void LogConsoleWidget::renderFrame()
+{
+    QElapsedTimer frame;
+    frame.start();
+    QVector<LogHistory::Batch> batches;
+    {
+        QMutexLocker locker(&m_pendingMutex);
+        batches.swap(m_pendingBatches);
+        if(m_frameBacklogPos >= m_frameBacklog.size()){
+            m_frameBacklog.clear();
+            m_frameBacklogPos = 0;
+            m_frameBacklog.swap(m_pendingLines);
+        }
+        else{
+            m_frameBacklog.append(m_pendingLines);
+            m_pendingLines.clear();
+        }
+    }
 
-    LogLine logLine(type, date, func, msg);
-    emit appendedNewLine(logLine);
-    m_history.append(logLine);
-    m_FuncSelector->addFunction(func);
-    m_formatter->appendFormatedLine(&curs, type, date, func, msg);
+    if(!batches.isEmpty() || m_frameBacklogPos < m_frameBacklog.size())
+    {
+        QMutexLocker locker(&m_mutex);
+        qint64 first = m_history.endIndex();
+        // пачки (слежение за файлом) добавляются целиком: колонки и текст UTF-8 копируются без разбора
+        for(const LogHistory::Batch& batch : std::as_const(batches))
+            storeBatch(batch);
+        // половина кадра остается на ввод и отрисовку, остаток строк ждет следующего кадра
+        int budget = qMax(1, m_frameTimer->interval() / 2);
+        while(m_frameBacklogPos < m_frameBacklog.size())
+        {
+            int count = qMin(frame_slice_lines, m_frameBacklog.size() - m_frameBacklogPos);
+            storeLines(m_frameBacklog.constData() + m_frameBacklogPos, count);
+            m_frameBacklogPos += count;
+            if(frame.elapsed() >= budget) break;
+        }
+        removeEvictedLines();
+        m_search->scanAppended();
 
-    ui->textEdit->setUpdatesEnabled(true);
+        // прокрутка и прилипание к концу - один раз за кадр
+        ui->logView->appendRows(visibleRows(first, m_history.endIndex()));
+    }
 
-    // Переносим позицию скролла если окно отображения в низу консоли (эффект прилипания)
-    if(!atBottom)
-        scroll->setValue(scrollValue);
-    else
-        scroll->setValue(scroll->maximum());
+    if(m_frameBacklogPos >= m_frameBacklog.size()){
+        m_frameBacklog.clear();
+        m_frameBacklogPos = 0;
+    }
+    else if(m_frameBacklogPos > m_frameBacklog.size() / 2){
+        m_frameBacklog.remove(0, m_frameBacklogPos);
+        m_frameBacklogPos = 0;
+    }
+    if(!m_frameBacklog.isEmpty()) return;
+
+    QMutexLocker locker(&m_pendingMutex);
+    if(m_pendingLines.isEmpty() && m_pendingBatches.isEmpty()){
+        m_frameScheduled = false;
+        m_frameTimer->stop();
+    }
 }
 
-void LogConsoleWidget::appendDocumentFragment(const QTextDocumentFragment &fragment)
+void LogConsoleWidget::storeLines(const LogLine *lines, int count)
 {
-    QMutexLocker locker(&m_mutex);
-    // Получаем QTextCursor из существующего QTextEdit
-    QTextCursor cursor = ui->textEdit->textCursor();
-
-    // Перемещаем курсор в конец текста, чтобы вставить фрагмент туда
-    cursor.movePosition(QTextCursor::End);
-    cursor.beginEditBlock();
-    // Вставляем сформированный фрагмент в текущее положение курсора
-    cursor.insertFragment(fragment);
-    cursor.endEditBlock();
+    bool notify = isSignalConnected(QMetaMethod::fromSignal(&LogConsoleWidget::appendedNewLine));
+    QSet<quint32> functions;
+    for(int i = 0; i < count; i++){
+        if(notify)
+            emit appendedNewLine(lines[i]);
+        functions.insert(lines[i].functionId);
+    }
+    {
+        QWriteLocker historyLocker(&m_historyLock);
+        for(int i = 0; i < count; i++)
+            m_history.append(lines[i]);
+    }
+    for(quint32 func : std::as_const(functions))
+        m_FuncSelector->addFunction(func);
 }
 
-void LogConsoleWidget::insertFrontDocumentFragment(const QTextDocumentFragment &fragment)
+void LogConsoleWidget::storeBatch(const LogHistory::Batch &batch)
 {
-    QMutexLocker locker(&m_mutex);
-    QTextCursor cursor = ui->textEdit->textCursor();
-
-    // Перемещаем курсор в начало текста, чтобы вставить фрагмент туда
-    cursor.movePosition(QTextCursor::Start);
-    cursor.beginEditBlock();
-    // Вставляем сформированный фрагмент в текущее положение курсора
-    cursor.insertFragment(fragment);
-    cursor.endEditBlock();
+    qint64 first;
+    {
+        QWriteLocker historyLocker(&m_historyLock);
+        first = m_history.endIndex();
+        m_history.append(batch);
+    }
+    // LogLine собираются только для подписчиков appendedNewLine
+    if(isSignalConnected(QMetaMethod::fromSignal(&LogConsoleWidget::appendedNewLine)))
+        for(qint64 i = qMax(first, m_history.firstIndex()); i < m_history.endIndex(); i++)
+            emit appendedNewLine(m_history.line(i));
+    for(quint32 func : batch.functions)
+        m_FuncSelector->addFunction(func);
 }
 
 void LogConsoleWidget::mousePressEvent(QMouseEvent *event) {
@@ -930,24 +1291,21 @@ void LogConsoleWidget::mouseReleaseEvent(QMouseEvent *event) {
     QWidget::mouseReleaseEvent(event);
 }
 
-QList<QVector<LogLine>> LogConsoleWidget::separateIntoBlocks(QVector<LogLine> &list)
+QVector<qint64> LogConsoleWidget::visibleRows(qint64 from, qint64 to)
 {
-    QList<QVector<LogLine>> vector;
-    int linesNum = list.size();
-    int blocksNum = (linesNum + line_count - 1) / line_count;
-    vector.reserve(blocksNum);
-    for(int b = 0; b < blocksNum; b++)
-    {
-        QVector<LogLine> block;
-        int size = std::min(linesNum, line_count);
-        block.reserve(size);
-        for(int i = 0; i < size; i++)
-            block.append(list[b * line_count + i]);
-
-        linesNum -= size;
-        vector.append(std::move(block));
+    qint64 timeFrom = 0, timeTo = 0;
+    bool timeFilter = m_formatter->timeWindow(timeFrom, timeTo);
+    if(timeFilter)
+        m_history.timeRange(timeFrom, timeTo, from, to);
+    else{
+        from = qMax(from, m_history.firstIndex());
+        to = qMin(to, m_history.endIndex());
     }
-    return vector;
+    QVector<qint64> rows;
+    if(from >= to) return rows;
+    rows.reserve(int(to - from));
+    m_formatter->appendVisibleRows(m_history, from, to, timeFrom, timeTo, rows);
+    return rows;
 }
 
 void LogConsoleWidget::updateContent()
@@ -955,85 +1313,209 @@ void LogConsoleWidget::updateContent()
     //QElapsedTimer timer;
     //timer.start();
 
-    m_mutex.lock();
-    ui->textEdit->clear();
-    QList<QVector<LogLine>> blocks = separateIntoBlocks(m_history);
-    QStandardItemModel* mod = m_FuncSelector->convertToStandardItemModel();
-    m_mutex.unlock();
-
-    if(m_settings.functions)
-        delete m_settings.functions;
-    m_settings.functions = mod;
-
-    for(const auto &block : std::as_const(blocks)){
-        QTextDocument* doc = m_formatter->formatBlockToDoc(block);
-        QTextDocumentFragment fr(doc);
-        //docFragments.append(std::move(fr));
-        appendDocumentFragment(std::move(fr));
-        delete doc;
-    }
+    QMutexLocker locker(&m_mutex);
+    // ограничения могли уменьшиться: лишние строки вытесняются до пересчета списка
+    applyHistoryLimits();
+    removeEvictedLines();
+    m_settings.functions = m_FuncSelector->functionFilter();
+    ui->logView->setTextFont(m_settings.textFormat.font());
+    // история не меняется: пересчитывается только список отображаемых строк
+    rebuildRows();
+    // фильтры могли измениться - совпадения ищутся заново
+    if(m_search->isActive())
+        startSearch();
     //std::cout << "time " << timer.nsecsElapsed()/1000/1000 << " ms;" << std::endl;
 }
 
+void LogConsoleWidget::rebuildRows()
+{
+    int generation = ++m_rowsGeneration;
+    m_rowsWatcher->cancel();
+
+    m_rowsFirst = m_history.firstIndex();
+    m_rowsEnd = m_history.endIndex();
+    // задачи фильтруют по копии настроек: GUI поток тем временем может их менять
+    QSharedPointer<ConsoleFormatter> filter(new ConsoleFormatter(&m_settings));
+    // окно времени находится двоичным поиском, задачи получают только его
+    qint64 begin = m_rowsFirst, end = m_rowsEnd;
+    qint64 timeFrom = 0, timeTo = 0;
+    bool timeFilter = filter->timeWindow(timeFrom, timeTo);
+    if(timeFilter)
+        m_history.timeRange(timeFrom, timeTo, begin, end);
+    QVector<QPair<qint64, qint64>> ranges;
+    for(qint64 from = begin; from < end; from += filter_chunk_size)
+        ranges.append({from, qMin(from + filter_chunk_size, end)});
+
+    std::function<QVector<qint64>(const QPair<qint64, qint64>&)> filterRange =
+        [this, filter, generation, timeFrom, timeTo](const QPair<qint64, qint64>& range)
+    {
+        QVector<qint64> rows;
+        QReadLocker locker(&m_historyLock);
+        // за время ожидания начало диапазона могло быть вытеснено
+        qint64 from = qMax(range.first, m_history.firstIndex());
+        qint64 to = qMin(range.second, m_history.endIndex());
+        if(from >= to) return rows;
+        rows.reserve(int(to - from));
+        for(qint64 i = from; i < to; i += filter_cancel_check)
+        {
+            if(m_rowsGeneration.load(std::memory_order_relaxed) != generation)
+                return QVector<qint64>();
+            filter->appendVisibleRows(m_history, i, qMin(i + filter_cancel_check, to), timeFrom, timeTo, rows);
+        }
+        return rows;
+    };
+    m_rowsWatcher->setFuture(Concurrent::mapped(m_threadPool, ranges, filterRange));
+}
+
+void LogConsoleWidget::applyRebuiltRows()
+{
+    if(m_rowsWatcher->isCanceled()) return;
+    QMutexLocker locker(&m_mutex);
+
+    // строки, добавленные во время пересчета (в начало - догрузкой файла), досчитываются здесь же
+    QVector<qint64> rows = visibleRows(m_history.firstIndex(), m_rowsFirst);
+    const QList<QVector<qint64>> results = m_rowsWatcher->future().results();
+    int count = rows.size();
+    for(const QVector<qint64>& part : results)
+        count += part.size();
+    rows.reserve(count);
+    for(const QVector<qint64>& part : results)
+        rows.append(part);
+    rows.append(visibleRows(m_rowsEnd, m_history.endIndex()));
+
+    ui->logView->setRows(rows);
+    ui->logView->removeRowsBefore(m_history.firstIndex());
+}
+
+void LogConsoleWidget::applyHistoryLimits()
+{
+    QWriteLocker historyLocker(&m_historyLock);
+    m_history.setLimits(m_settings.historyMaxLines, (qint64)m_settings.historyMaxMegabytes * 1024 * 1024);
+}
+
+void LogConsoleWidget::removeEvictedLines()
+{
+    ui->logView->removeRowsBefore(m_history.firstIndex());
+    m_search->discardBefore(m_history.firstIndex());
+    const QVector<quint32> released = m_history.takeReleasedFunctions();
+    for(quint32 func : released)
+        if(!m_history.functionLines(func))
+            m_FuncSelector->removeFunction(func);
+}
+
+void LogConsoleWidget::clearHistory()
+{
+    cancelLoading();
+    m_rowsGeneration++;
+    m_rowsWatcher->cancel();
+    // строки, пришедшие до очистки, но еще не добавленные, тоже отбрасываются
+    {
+        QMutexLocker pendingLocker(&m_pendingMutex);
+        m_pendingLines.clear();
+        m_pendingBatches.clear();
+    }
+    m_frameBacklog.clear();
+    m_frameBacklogPos = 0;
+    ui->logView->clear();
+    {
+        QWriteLocker historyLocker(&m_historyLock);
+        m_history.clear();
+    }
+    // поиск продолжается по новым строкам
+    if(m_search->isActive())
+        startSearch();
+}
+
+void LogConsoleWidget::startSearch()
+{
+    QString text = ui->lineEdit_search->text();
+    Qt::CaseSensitivity cs = ui->checkBox_searchCase->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    m_currentMatch = -1;
+    ui->logView->setCurrentMatch(-1);
+    ui->logView->setHighlight(text, cs);
+    // ищутся только строки, проходящие фильтры консоли (по копии настроек, как в rebuildRows)
+    m_search->start(text, cs, QSharedPointer<ConsoleFormatter>(new ConsoleFormatter(&m_settings)));
+    updateSearchCount();
+}
+
+void LogConsoleWidget::jumpToMatch(bool forward)
+{
+    if(!m_search->isActive()) return;
+    qint64 end = m_history.endIndex();
+    qint64 match = forward ? m_search->nextMatch(m_currentMatch)
+                           : m_search->previousMatch(m_currentMatch < 0 ? end : m_currentMatch);
+    // по кругу: после последнего - первое, перед первым - последнее
+    if(match < 0)
+        match = forward ? m_search->nextMatch(-1) : m_search->previousMatch(end);
+    if(match < 0) return;
+    m_currentMatch = match;
+    ui->logView->setCurrentMatch(match);
+    ui->logView->scrollToRow(ui->logView->rowOf(match));
+}
+
+void LogConsoleWidget::updateSearchCount()
+{
+    if(!m_search->isActive()){
+        ui->label_searchCount->clear();
+        return;
+    }
+    QString count = QString::number(m_search->matchCount());
+    if(m_search->isRunning())
+        count += "…";
+    ui->label_searchCount->setText(count);
+}
+
 
 
 LogLine::LogLine(const QString &line){
     if(line.isEmpty()) return;
 
     int msgSepIndex = line.indexOf(" >> ");  // промт разделяющий сообщение и информацию
-    if(msgSepIndex == -1){
+    thread_local LogLineParser parser;
+    if(msgSepIndex == -1 || !parser.parseHeader(line.constData(), msgSepIndex, *this)){
         message = line;
         only_message = true;
         return;
     }
     message = line.mid(msgSepIndex + 4);
+}
 
-    QStringList list = line.left(msgSepIndex).split(" ",  QString::SkipEmptyParts);
-    if(list.size() >= 3){
-        // при имспользовании некоторых функций QDate QTime QDateTime включая парсер,
-        // регистрируется календарь QCalendar причем это происходит непотокобезопасно
-        // поэтому создаю его статическим
-        static QCalendar calendar;
-        //парсим дату
-        QStringList dateList = list[0].split("-");
-        if(dateList.size() >= 3){
-            int yy = dateList[0].toLong();
-            int mm = dateList[1].toLong();
-            int dd = dateList[2].toLong();
-            QDate date(yy, mm, dd, calendar);
-            dateTime.setDate(date);
-        }
-
-        //парсим время
-        QStringList timeList = list[1].split(":");
-        if(timeList.size() >=3){
-            int hh = timeList[0].toLong();
-            int MM = timeList[1].toLong();
-            QStringList timeMsS = timeList[2].split(".");
-            int ss = timeMsS[0].toLong();
-            if(timeList.size() >=2){
-                int zzz= timeMsS[1].toLong();
-                QTime time(hh, MM, ss, zzz);
-                dateTime.setTime(time);
-            }
-            else
-            {
-                QTime time(hh, MM, ss);
-                dateTime.setTime(time);
-            }
-        }
-
-        //dateTime.setDate(QDate::fromString(list[0], "yyyy-MM-dd"));
-        //dateTime.setTime(QTime::fromString(list[1], "hh:mm:ss.zzz"));
+bool LogLine::parseHeader(const QString &header)
+{
+    QStringList list = header.split(" ",  QString::SkipEmptyParts);
+    if(list.size() < 3) return false;
+
+    //парсим дату
+    int yy = 1970, mm = 1, dd = 1;
+    QStringList dateList = list[0].split("-");
+    if(dateList.size() >= 3){
+        yy = dateList[0].toLong();
+        mm = dateList[1].toLong();
+        dd = dateList[2].toLong();
+    }
 
-        type = StringToMsgType(list[2]);
-        if(list.size() >= 4)
-            functionStr = list[3];
+    //парсим время
+    int hh = 0, MM = 0, ss = 0, zzz = 0;
+    QStringList timeList = list[1].split(":");
+    if(timeList.size() >=3){
+        hh = timeList[0].toLong();
+        MM = timeList[1].toLong();
+        QStringList timeMsS = timeList[2].split(".");
+        ss = timeMsS[0].toLong();
+        if(timeMsS.size() >=2)
+            zzz= timeMsS[1].toLong();
     }
-    else
-    {
-        message = line;
-        only_message = true;
-        return;
+    timestamp = Time::fromParts(yy, mm, dd, hh, MM, ss, zzz);
+
+    type = StringToMsgType(list[2]);
+    if(list.size() >= 4){
+        // последним может идти категория в квадратных скобках
+        const QString& last = list.last();
+        bool hasCategory = last.size() > 2 && last.startsWith('[') && last.endsWith(']');
+        if(hasCategory)
+            categoryId = CategoryTable::intern(last.mid(1, last.size() - 2));
+        if(list.size() >= 5 || !hasCategory)
+            functionId = FunctionTable::intern(list[3]);
     }
+    return true;
 }
@@ -2,11 +2,19 @@
 #define LOGCONSOLEWIDGET_H
 
 
+#include "LogFileIndex.h"
+#include "LogHistory.h"
 #include "Logging.h"
+#include "LoggingSymbols.h"
+#include "LoggingTime.h"
 #include "qdatetime.h"
+#include "qfuturewatcher.h"
 #include "qmutex.h"
+#include "qreadwritelock.h"
 #include "qtextcursor.h"
+#include "qtextlayout.h"
 #include <QWidget>
+#include <atomic>
 #include "Logging.h"
 
 /*! ConsoleFormatter example
@@ -61,12 +69,15 @@ class LogConsoleWidget;
 }
 QT_END_NAMESPACE
 
-class QStandardItemModel;
 class QTextDocument;
+class QThreadPool;
+class QTimer;
 namespace Logging
 {
 
 class LogConsoleWidget;
+class LogSearch;
+class LogFileFollower;
 class ConsoleLogFormatter;
 class FunctionSelectorWidget;
 
@@ -82,6 +93,7 @@ struct ConsoleSettings
         int timeMs : 1;
         int logLevel : 1;
         int messageSource : 1;
+        int category : 1;
     } dispField;
     struct
     {
@@ -111,9 +123,26 @@ struct ConsoleSettings
     bool extendedColors;
     bool restoreWindowPosSize;
     QTextCharFormat textFormat;
-    //QDate filterStartDate;
-    // QDate filterEndDate;
-    QStandardItemModel* functions;
+    int historyMaxLines;     // ограничение истории по числу строк, 0 - без ограничения
+    int historyMaxMegabytes; // ограничение истории по памяти в МБ, 0 - без ограничения
+    /*!
+     *  фильтр по времени сообщений (метки времени - см. LoggingTime.h)
+     */
+    enum TimeFilter
+    {
+        TimeFilterOff,        // без фильтра
+        TimeFilterRange,      // [filterStartTime, filterEndTime]
+        TimeFilterLastMinutes // последние filterLastMinutes минут
+    };
+    int timeFilter;
+    qint64 filterStartTime;
+    qint64 filterEndTime;
+    int filterLastMinutes;
+    /*!
+     *  фильтр функций: functions[id] == false - строки функции с этим id (FunctionTable) скрыты,
+     *  функции с id за пределами вектора отображаются
+     */
+    QVector<bool> functions;
 };
 
 /*!
@@ -125,21 +154,46 @@ class LogLine
 public:
     LogLine(){};
     LogLine(const QString &line);
+    LogLine(const QtMsgType& logLevel, qint64 stamp,
+            quint32 function, const QString msg, quint32 category = 0):
+        timestamp(stamp), type(logLevel), functionId(function), message(msg), categoryId(category){};
+    LogLine(const QtMsgType& logLevel, qint64 stamp,
+            const QString& func, const QString msg, quint32 category = 0):
+        timestamp(stamp), type(logLevel), functionId(FunctionTable::intern(func)), message(msg), categoryId(category){};
     LogLine(const QtMsgType& logLevel, const QDateTime& date,
             const QString& func, const QString msg):
-        dateTime(date), type(logLevel), functionStr(func), message(msg){};
+        timestamp(Time::fromDateTime(date)), type(logLevel), functionId(FunctionTable::intern(func)), message(msg){};
     ~LogLine(){};
-    inline QString toQString(){
+    /*!
+     * \brief toQString строка в формате файла логов:
+     *  "yyyy-MM-dd hh:mm:ss.zzz LEVEL func >> msg",
+     *  для категорий кроме "default": "yyyy-MM-dd hh:mm:ss.zzz LEVEL func [category] >> msg"
+     */
+    inline QString toQString() const {
         if(only_message) return message;
-        QString timeDateStr = dateTime.toString("yyyy-MM-dd hh:mm:ss.zzz");
+        thread_local TimestampFormatter formatter;
+        if(categoryId)
+            return QString("%1 %2 %3 [%4] >> %5")
+                .arg(formatter.format(timestamp), msgTypeToString(type), functionName(),
+                     CategoryTable::name(categoryId), message);
         return QString("%1 %2 %3 >> %4")
-            .arg(timeDateStr, msgTypeToString(type), functionStr, message);
+            .arg(formatter.format(timestamp), msgTypeToString(type), functionName(), message);
     }
+    /*!
+     * \brief parseHeader разбирает заголовок строки (часть до " >> "):
+     *  "yyyy-MM-dd hh:mm:ss.zzz LEVEL func [category]". false - это не заголовок.
+     *  Разбор общего вида через QStringList; заголовки точно в этом формате
+     *  быстрее разбирает LogLineParser, остальные он передает сюда
+     */
+    bool parseHeader(const QString& header);
+    inline QDateTime dateTime() const { return Time::toDateTime(timestamp); }
+    inline const QString& functionName() const { return FunctionTable::name(functionId); }
 
-    QDateTime dateTime;
+    qint64 timestamp = 0; // локальное время в мс (см. LoggingTime.h)
     QtMsgType type;
-    QString functionStr;
+    quint32 functionId = 0; // id из FunctionTable
     QString message;
+    quint32 categoryId = 0; // id из CategoryTable
     bool only_message = false;
 };
 
@@ -154,25 +208,56 @@ class ConsoleFormatter
 public:
     ConsoleFormatter(LogConsoleWidget* cli);// взять указатель на ConsoleSettings из LogConsoleWidget
     ConsoleFormatter(ConsoleSettings* settings);// скопировать экземпляр ConsoleSettings
+    ConsoleFormatter(const ConsoleFormatter& other);// копия с собственным экземпляром ConsoleSettings (для параллельной обработки)
+    ConsoleFormatter& operator=(const ConsoleFormatter&) = delete;
     ~ConsoleFormatter();
 
 
-    static QPair<QVector<LogLine>, QStringList> stringList2LogLines(const QStringList &block);
     QTextDocument* formatBlockToDoc(const QVector<LogLine> &block);
 
     inline void appendFormatedLine(QTextCursor* curs, const LogLine& line);
-    inline void appendFormatedLine(QTextCursor* curs, QtMsgType type, const QDateTime& date,
-                            const QString& func, const QString& msg);
+    inline void appendFormatedLine(QTextCursor* curs, QtMsgType type, qint64 timestamp,
+                            quint32 function, const QString& msg, quint32 category = 0);
     inline void appendSimpleLine(QTextCursor* curs, QtMsgType type, const QString& msg);
 
+    /*!
+     * \brief formatLine формирует текст строки для отображения по настройкам консоли
+     *  и (если formats != nullptr) цветовую разметку полей для QTextLayout.
+     *  В messageStart (если не nullptr) - позиция текста сообщения в строке
+     */
+    QString formatLine(const LogLine& line, QVector<QTextLayout::FormatRange>* formats,
+                       int* messageStart = nullptr);
+    /*!
+     * \brief isLineVisible проходит ли строка фильтры уровня логирования, категории и функции
+     */
+    bool isLineVisible(QtMsgType type, quint32 function, quint32 category) const;
+    bool isLevelEnabled(QtMsgType type) const;
+    /*!
+     * \brief timeWindow окно фильтра по времени [from, to]: для "последних N минут"
+     *  отсчитывается от текущего момента. false - фильтр по времени выключен (окно - все время)
+     */
+    bool timeWindow(qint64& from, qint64& to) const;
+    /*!
+     * \brief appendVisibleRows дописывает в rows номера строк [from, to) истории, прошедших фильтры
+     *  уровня, времени (окно [timeFrom, timeTo], см. timeWindow), категории и функции.
+     *  Уровень и время проверяются по колонкам истории одним циклом без ветвлений,
+     *  функция и категория - только у прошедших его строк
+     */
+    void appendVisibleRows(const LogHistory& history, qint64 from, qint64 to,
+                           qint64 timeFrom, qint64 timeTo, QVector<qint64>& rows) const;
+
 private:
     void setMsgColorFormat(QtMsgType type); // устанавливает цветовой формат основного сообщения по QtMsgType
     void setMsgColorFormat(const QString& type); // устанавливает цветовой формат основного сообщения по строке ex:"DEBUG"
-    bool isFunctionChecked(const QString& func); //возвращает false если функция отключена в сортировке
+    //возвращает false если функция отключена в сортировке
+    inline bool isFunctionChecked(quint32 function) const {
+        return function >= (quint32)m_settings->functions.size() || m_settings->functions.at(function);
+    }
     ConsoleSettings* m_settings = nullptr;
     bool m_releaseMem = false;
     QColor m_currMsgColor;
     QColor m_currMsgBgColor;
+    TimestampFormatter m_timeFormatter;
 };
 
 /*!
@@ -195,9 +280,38 @@ public:
     bool loadSettings(QString path);
 
     /*!
-     * \brief loadLogsHistory загружает файл логов, парсит и отобраает.
+     * \brief loadLogsHistory загружает файл логов, парсит и отобраает вместо текущего содержимого.
+     *  Последние строки файла показываются сразу, более старые догружаются в фоне с конца
+     *  и добавляются в начало (индикатор загрузки с кнопкой отмены).
      */
     bool loadLogsHistory(QString path);
+    /*!
+     * \brief loadLogsAtLine показывает вместо текущего содержимого строки файла вокруг строки line
+     *  (с 0, пустые строки не считаются). Читается только нужная часть файла: ее положение берется
+     *  из индекса рядом с файлом (LogFileIndex), который строится при первом открытии
+     *  и дополняется, когда файл растет. Индекс обновляется в фоне (индикатор загрузки
+     *  с кнопкой отмены), строки показываются по готовности. false - загрузка начата
+     */
+    bool loadLogsAtLine(QString path, qint64 line);
+    /*!
+     * \brief loadLogsAtTime то же для первой строки со временем не раньше time
+     */
+    bool loadLogsAtTime(QString path, const QDateTime& time);
+    /*!
+     * \brief cancelLoading останавливает догрузку старых строк файла (загруженное остается)
+     *  или индексирование файла для loadLogsAtLine/loadLogsAtTime
+     */
+    void cancelLoading();
+    bool isLoading() const;
+    /*!
+     * \brief setFollowLogFile режим слежения: строки, дописываемые в загруженный файл другим процессом,
+     *  добавляются в консоль по мере записи (LogFileFollower). Файл, загруженный позже, тоже отслеживается.
+     *  Если файл m_logFilePath еще не загружен или показана часть из его середины (loadLogsAtLine,
+     *  loadLogsAtTime), загружается конец файла (loadLogsHistory).
+     *  Файл, в который пишет сам процесс, не отслеживается (см. LogFileFollower::start)
+     */
+    void setFollowLogFile(bool follow);
+    bool isFollowingLogFile() const { return m_followLogFile; }
 
     /*!
      * \brief getLogFilePath геттер для получения пути до файла в котором храняться логи.
@@ -215,27 +329,51 @@ public:
     }
 
     /*!
-     * \brief appendFormatedLine добавляет строку в виджет с заданным шаблоном.
+     * \brief appendFormatedLine добавляет строку в виджет с заданным шаблоном (в ближайшем кадре, см. postLines).
      * Нельзя вызывать из других потоков!
      * шаблон: 2024-09-17 21:31:40.175 INFO functionName >> Debug info from worker thread hash
      */
     void appendFormatedLine(const QString& line);
     /*!
-     * \brief appendFormatedLine добавляет строку в виджет.
+     * \brief appendFormatedLine добавляет строку в виджет (в ближайшем кадре, см. postLines).
      * Нельзя вызывать из других потоков!
      */
     void appendFormatedLine(QtMsgType type, QDateTime date, QString func, const QString msg);
-
     /*!
-     * \brief appendDocumentFragment добавляет фрагмент документа в консоль с конца.
+     * \brief appendLines сразу добавляет пачку строк в виджет: одно добавление в историю
+     *  и одно обновление прокрутки на всю пачку.
      * Нельзя вызывать из других потоков!
      */
-    void appendDocumentFragment(const QTextDocumentFragment& msg);
+    void appendLines(const QVector<LogLine>& lines);
     /*!
-     * \brief insertFrontDocumentFragment добавляет фрагмент документа в консоль с начала.
-     * Нельзя вызывать из других потоков!
+     * \brief postLines кладет строки в буфер ожидания. Можно вызывать из любых потоков.
+     *  GUI поток забирает буфер раз в кадр (setFrameInterval) и добавляет строки в пределах
+     *  бюджета времени кадра, остаток переносится на следующий кадр.
+     */
+    void postLines(const QVector<LogLine>& lines);
+    /*!
+     * \brief postBatch кладет в буфер ожидания пачку разобранных строк (LogFileReader::parseLines).
+     *  Можно вызывать из любых потоков. Пачка добавляется в историю в ближайшем кадре целиком,
+     *  без перевода сообщений в QString и обратно
+     */
+    void postBatch(const LogHistory::Batch& batch);
+    /*!
+     * \brief setFrameInterval период кадра отрисовки в мс (по умолчанию 16).
+     *  Добавление строк за кадр ограничено половиной периода, чтобы окно оставалось отзывчивым.
+     */
+    void setFrameInterval(int msec);
+    int frameInterval() const;
+    /*!
+     * \brief setTimeFilter показывает только строки со временем в [from, to] (вместе с фильтрами
+     *  уровней и функций). Окно находится двоичным поиском по времени строк истории
+     */
+    void setTimeFilter(const QDateTime& from, const QDateTime& to);
+    /*!
+     * \brief setTimeFilterLastMinutes показывает только строки за последние minutes минут
+     *  (окно отсчитывается от момента применения фильтров, новые строки показываются)
      */
-    void insertFrontDocumentFragment(const QTextDocumentFragment& msg);
+    void setTimeFilterLastMinutes(int minutes);
+    void clearTimeFilter();
 
 
     //void appendLine(const QString& line);
@@ -256,16 +394,86 @@ signals:
 
 private:
     /*!
-     * \brief separateIntoBlocks делит вектор из строк логов в вектор из блоков
-     *  содержащих по несколько десятков строк логов
-     */
-    static QList<QVector<LogLine>> separateIntoBlocks(QVector<LogLine>& list);
-    /*!
-     * \brief updateContent перезагружает содеримое виджета
-     * удаляет содержимое textEdit и загружает его заново из истории.
+     * \brief updateContent перезагружает содеримое виджета:
+     * применяет шрифт и запускает пересчет списка отображаемых строк истории по фильтрам (rebuildRows).
      * необходимо вызывать после обновления любых настроек по цветовой политре или сортировке
      */
     void updateContent();
+    /*!
+     * \brief rebuildRows пересчитывает список отображаемых строк в фоне: история делится
+     *  на диапазоны, которые фильтруются параллельно по копии настроек.
+     *  Повторный вызов отменяет незавершенный пересчет.
+     */
+    void rebuildRows();
+    /*!
+     * \brief applyRebuiltRows передает результат rebuildRows в отображение
+     */
+    void applyRebuiltRows();
+    /*!
+     * \brief visibleRows номера строк истории [from, to), прошедших фильтры
+     */
+    QVector<qint64> visibleRows(qint64 from, qint64 to);
+    /*!
+     * \brief applyHistoryLimits передает ограничения из m_settings в историю
+     */
+    void applyHistoryLimits();
+    /*!
+     * \brief removeEvictedLines убирает вытесненные из истории строки из отображения,
+     *  а функции, от которых не осталось строк, - из FunctionSelectorWidget
+     */
+    void removeEvictedLines();
+    /*!
+     * \brief renderFrame кадр отрисовки: забирает строки из буфера postLines(..), добавляет их
+     *  в историю, пока не исчерпан бюджет кадра, и один раз обновляет отображение
+     */
+    void renderFrame();
+    /*!
+     * \brief storeLines добавляет строки в историю и их функции в FunctionSelectorWidget (под m_mutex)
+     */
+    void storeLines(const LogLine* lines, int count);
+    /*!
+     * \brief storeBatch добавляет пачку в историю и ее функции в FunctionSelectorWidget (под m_mutex)
+     */
+    void storeBatch(const LogHistory::Batch& batch);
+    /*!
+     * \brief scheduleFrame запускает таймер кадров, если он еще не запущен (под m_pendingMutex)
+     */
+    void scheduleFrame();
+    /*!
+     * \brief startSearch перезапускает поиск по тексту из строки поиска с текущими фильтрами
+     */
+    void startSearch();
+    /*!
+     * \brief jumpToMatch переходит к следующему (forward) или предыдущему совпадению, по кругу
+     */
+    void jumpToMatch(bool forward);
+    void updateSearchCount();
+    /*!
+     * \brief clearHistory очищает историю, отображение и строки, ожидающие добавления
+     */
+    void clearHistory();
+    /*!
+     * \brief takeLoadedBatches добавляет в начало истории разобранные части файла по порядку (с конца файла)
+     */
+    void takeLoadedBatches();
+    /*!
+     * \brief loadIndexedLines запускает фоновую загрузку кусков индекса файла вокруг
+     *  строки line или первой строки со временем не раньше timestamp (byTime)
+     */
+    bool loadIndexedLines(const QString& path, bool byTime, qint64 target);
+    /*!
+     * \brief showIndexedLines заменяет содержимое загруженными кусками и переходит к искомой строке
+     */
+    void showIndexedLines();
+    /*!
+     * \brief stopIndexing прерывает загрузку кусков индекса, не дожидаясь ее результата
+     */
+    void stopIndexing();
+    /*!
+     * \brief showHistoryLine прокручивает к строке истории index или к следующей за ней отображаемой
+     */
+    void showHistoryLine(qint64 index);
+    void finishLoading();
 
     QMutex m_mutex;
     Ui::LogConsoleWidget *ui;
@@ -275,7 +483,37 @@ private:
 
     ConsoleSettings m_settings;
     ConsoleFormatter* m_formatter;
-    QVector<LogLine> m_history;
+    LogHistory m_history;
+    // история меняется только в GUI потоке под записью, фоновый пересчет строк читает ее под чтением
+    QReadWriteLock m_historyLock;
+    QFutureWatcher<QVector<qint64>>* m_rowsWatcher = nullptr;
+    std::atomic<int> m_rowsGeneration = 0; // номер последнего пересчета, устаревшие прерываются
+    qint64 m_rowsFirst = 0;                 // начало диапазона истории последнего пересчета
+    qint64 m_rowsEnd = 0;                   // конец
+
+    QMutex m_pendingMutex; // защищает m_pendingLines, m_pendingBatches и m_frameScheduled
+    QVector<LogLine> m_pendingLines;
+    QVector<LogHistory::Batch> m_pendingBatches;
+    bool m_frameScheduled = false;
+    QTimer* m_frameTimer = nullptr;
+    QVector<LogLine> m_frameBacklog; // строки, не уместившиеся в бюджет прошлых кадров (только GUI поток)
+    int m_frameBacklogPos = 0;
+
+    QThreadPool* m_threadPool = nullptr; // потоки фоновой работы консоли, по числу ядер
+    QFutureWatcher<LogHistory::Batch>* m_loadWatcher = nullptr; // догрузка старых строк файла
+    int m_loadNext = 0;  // номер следующей части файла (с конца), добавляемой в историю
+    int m_loadCount = 0;
+    qint64 m_loadedFileSize = -1; // размер файла m_logFilePath при загрузке, -1 - не загружен (или загружена часть без конца файла)
+    QFutureWatcher<LogFileIndex::Window>* m_indexWatcher = nullptr; // загрузка строк файла по индексу
+    QString m_indexPath;     // файл, его искомая строка или время
+    bool m_indexByTime = false;
+    qint64 m_indexTarget = 0;
+
+    LogFileFollower* m_follower = nullptr;
+    bool m_followLogFile = false;
+
+    LogSearch* m_search = nullptr;
+    qint64 m_currentMatch = -1; // номер строки истории текущего совпадения
 
     QVector<QColor> m_customColors;
 
@@ -0,0 +1,157 @@
+#include "LogFileFollower.h"
+#include "LogConsoleWidget.h"
+#include "LogFileReader.h"
+#include "Logging.h"
+#include "qdir.h"
+#include "qfile.h"
+#include "qfileinfo.h"
+#include "qfilesystemwatcher.h"
+#include <QtConcurrent>
+
+using namespace Logging;
+
+const int follow_read_size = 4 * 1024 * 1024; // байт файла за одно чтение
+const int follow_head_size = 256;             // байт начала файла для проверки замены
+
+LogFileFollower::LogFileFollower(LogConsoleWidget *console, QThreadPool *pool, QObject *parent) :
+    QObject(parent), m_console(console), m_pool(pool)
+{
+    m_watcher = new QFileSystemWatcher(this);
+    m_reader = new QFutureWatcher<void>(this);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &LogFileFollower::scheduleRead);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &LogFileFollower::onDirectoryChanged);
+    connect(m_reader, &QFutureWatcher<void>::finished, this, &LogFileFollower::readFinished);
+}
+
+LogFileFollower::~LogFileFollower()
+{
+    stop();
+}
+
+bool LogFileFollower::start(const QString &path, qint64 offset)
+{
+    stop();
+    if(isOwnLogFile(path)) return false;
+    m_path = path;
+    m_offset = offset;
+    m_partial.clear();
+    m_head.clear();
+    m_skipPartial = false;
+    QFile file(path);
+    if(offset > 0 && file.open(QFile::ReadOnly) && file.seek(offset - 1)){
+        char last = 0;
+        m_skipPartial = file.getChar(&last) && last != '\n';
+    }
+
+    // каталог - чтобы заметить файл, созданный заново после ротации
+    m_watcher->addPath(path);
+    m_watcher->addPath(QFileInfo(path).absolutePath());
+    // строки, дописанные после загрузки
+    scheduleRead();
+    return true;
+}
+
+void LogFileFollower::stop()
+{
+    m_stop = true;
+    m_reader->waitForFinished();
+    m_stop = false;
+    m_readAgain = false;
+    m_replaced = false;
+    if(!m_watcher->files().isEmpty())
+        m_watcher->removePaths(m_watcher->files());
+    if(!m_watcher->directories().isEmpty())
+        m_watcher->removePaths(m_watcher->directories());
+    m_path.clear();
+}
+
+void LogFileFollower::scheduleRead()
+{
+    if(m_path.isEmpty()) return;
+    if(m_reader->isRunning()){
+        m_readAgain = true;
+        return;
+    }
+    m_readAgain = false;
+    m_reader->setFuture(QtConcurrent::run(m_pool, [this]() { readAppended(); }));
+}
+
+void LogFileFollower::readFinished()
+{
+    if(m_replaced)
+    {
+        m_replaced = false;
+        // консоль обрабатывает замену до того, как придут строки нового содержимого
+        emit fileReplaced();
+        m_readAgain = true;
+    }
+    if(m_readAgain)
+        scheduleRead();
+}
+
+void LogFileFollower::onDirectoryChanged()
+{
+    // удаленный (переименованный) файл QFileSystemWatcher перестает отслеживать
+    if(m_path.isEmpty() || m_watcher->files().contains(m_path) || !QFile::exists(m_path)) return;
+    m_watcher->addPath(m_path);
+    scheduleRead();
+}
+
+void LogFileFollower::readAppended()
+{
+    QFile file(m_path);
+    if(!file.open(QFile::ReadOnly)) return; // файл переименован, а новый еще не создан
+
+    if(file.size() < m_offset || !isSameFile(file))
+    {
+        // усечение или ротация: новое содержимое читается с начала следующим чтением,
+        // после сигнала fileReplaced() (см. readFinished)
+        m_offset = 0;
+        m_partial.clear();
+        m_head.clear();
+        m_skipPartial = false;
+        m_replaced = true;
+        return;
+    }
+    if(m_head.size() < follow_head_size && file.seek(0))
+        m_head = file.read(follow_head_size);
+    if(!file.seek(m_offset)) return;
+
+    while(!m_stop)
+    {
+        QByteArray block = file.read(follow_read_size);
+        if(block.isEmpty()) break;
+        m_offset += block.size();
+        m_partial.append(block);
+
+        const char* data = m_partial.constData();
+        const char* end = data + m_partial.size();
+        const char* last = LogFileReader::findLastNewline(data, end);
+        if(last == end) continue; // строка еще не дописана
+        const char* begin = data;
+        if(m_skipPartial){
+            begin = LogFileReader::findNewline(data, end) + 1;
+            m_skipPartial = false;
+        }
+        postBatch(begin, last + 1 - begin);
+        m_partial.remove(0, int(last + 1 - data));
+    }
+}
+
+bool LogFileFollower::isOwnLogFile(const QString &path)
+{
+    QString own = Logging::loggingFile();
+    return !own.isEmpty() && QFileInfo(own).canonicalFilePath() == QFileInfo(path).canonicalFilePath();
+}
+
+bool LogFileFollower::isSameFile(QFile &file) const
+{
+    if(m_head.isEmpty()) return true;
+    return file.seek(0) && file.read(m_head.size()) == m_head;
+}
+
+void LogFileFollower::postBatch(const char *data, qint64 size)
+{
+    // пачка идет в консоль как есть: сообщения остаются в UTF-8 до самой истории
+    m_console->postBatch(LogFileReader::parseLines(data, size));
+}
@@ -0,0 +1,101 @@
+#ifndef LOGFILEFOLLOWER_H
+#define LOGFILEFOLLOWER_H
+
+#include "qbytearray.h"
+#include "qfuturewatcher.h"
+#include "qstring.h"
+#include <QObject>
+#include <atomic>
+
+class QFile;
+class QFileSystemWatcher;
+class QThreadPool;
+
+
+namespace Logging {
+
+class LogConsoleWidget;
+
+/*!
+ * \brief The LogFileFollower class слежение за файлом логов, который дописывает другой процесс.
+ *  Файл и его каталог отслеживаются QFileSystemWatcher (inotify), по изменению в фоне читаются
+ *  только байты после последнего прочитанного смещения. Целые строки разбираются
+ *  (LogFileReader::parseLines) и передаются в консоль пачкой через LogConsoleWidget::postBatch,
+ *  недописанная последняя строка ждет своего '\n'.
+ *  Усечение (размер меньше смещения) и замена файла (ротация: начало файла не то, что было)
+ *  определяются при каждом чтении: чтение прерывается, в GUI потоке посылается fileReplaced(),
+ *  и только после этого файл читается с начала - его строки приходят уже после сигнала.
+ *  Одновременно идет не больше одного чтения: изменения во время чтения объединяются в следующее.
+ *  Методы вызываются из GUI потока.
+ */
+class LogFileFollower : public QObject
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief LogFileFollower строки передаются в console, файл читается задачей пула pool
+     */
+    LogFileFollower(LogConsoleWidget* console, QThreadPool* pool, QObject* parent = nullptr);
+    ~LogFileFollower();
+
+    /*!
+     * \brief start следит за файлом path с байта offset (конец уже загруженной части).
+     *  Если offset - середина строки, ее остаток пропускается: строка уже загружена.
+     *  Файл, в который пишет сам процесс (Logging::loggingFile()), не отслеживается:
+     *  его строки и так приходят в консоль через messageHandler и выводились бы дважды.
+     *  Возвращает false, если слежение не начато
+     */
+    bool start(const QString& path, qint64 offset);
+    /*!
+     * \brief isOwnLogFile path - файл, в который сейчас пишет Logging
+     */
+    static bool isOwnLogFile(const QString& path);
+    /*!
+     * \brief stop прекращает слежение, дожидаясь текущего чтения
+     */
+    void stop();
+    bool isActive() const { return !m_path.isEmpty(); }
+    const QString& path() const { return m_path; }
+    /*!
+     * \brief readOffset конец прочитанных целых строк (после stop() - откуда продолжить)
+     */
+    qint64 readOffset() const { return m_offset - m_partial.size(); }
+
+signals:
+    /*!
+     * \brief fileReplaced файл усечен или заменен новым: отправленные раньше строки
+     *  относятся к прежнему содержимому. Строки нового содержимого отправляются после сигнала
+     */
+    void fileReplaced();
+
+private:
+    void scheduleRead();
+    void readFinished();
+    void onDirectoryChanged();
+    /*!
+     * \brief readAppended читает и отправляет в консоль строки, дописанные с прошлого чтения (в фоне)
+     */
+    void readAppended();
+    bool isSameFile(QFile& file) const;
+    void postBatch(const char* data, qint64 size);
+
+    LogConsoleWidget* m_console;
+    QThreadPool* m_pool;
+    QFileSystemWatcher* m_watcher;
+    QFutureWatcher<void>* m_reader;
+    bool m_readAgain = false;       // файл менялся во время чтения
+    bool m_replaced = false;        // чтение обнаружило замену файла (пишет задача чтения)
+    std::atomic<bool> m_stop{false};
+
+    // меняются только задачей чтения, пока она идет
+    QString m_path;
+    qint64 m_offset = 0;            // прочитано байт файла
+    QByteArray m_partial;           // недописанная последняя строка
+    QByteArray m_head;              // начало файла: другое начало - файл заменен
+    bool m_skipPartial = false;     // пропустить байты до первого '\n'
+};
+
+} //namespace Logging
+
+
+#endif // LOGFILEFOLLOWER_H
@@ -0,0 +1,210 @@
+#include "LogFileIndex.h"
+#include "qdatastream.h"
+#include "qdatetime.h"
+#include "qfile.h"
+#include "qfileinfo.h"
+#include "qfutureinterface.h"
+#include "qrunnable.h"
+#include "qsavefile.h"
+#include "qthreadpool.h"
+#include <algorithm>
+
+using namespace Logging;
+
+const quint32 index_magic = 0x4C434958; // "LCIX"
+const quint32 index_version = 1;
+const int index_stride = 4096;     // строк в одном куске индекса
+const int index_head_size = 4096;  // байт начала файла в контрольной сумме
+const qint64 index_progress_bytes = 4 * 1024 * 1024; // байт между отчетами о прогрессе
+
+namespace {
+
+/*!
+ * \brief The LoadWindowTask class задача LogFileIndex::loadWindow
+ */
+class LoadWindowTask : public QRunnable
+{
+public:
+    LoadWindowTask(const QString& path, bool byTime, qint64 target, int count) :
+        m_path(path), m_byTime(byTime), m_target(target), m_count(count) {}
+
+    QFuture<LogFileIndex::Window> start()
+    {
+        m_future.reportStarted();
+        return m_future.future();
+    }
+
+    void run() override
+    {
+        LogFileIndex::Window window;
+        LogFileReader reader(m_path);
+        LogFileIndex index(m_path);
+        if(!m_future.isCanceled() && reader.open() && index.update(reader, &m_future) && !index.isEmpty())
+        {
+            int chunk = m_byTime ? index.chunkOfTime(m_target) : index.chunkOfLine(m_target);
+            int firstChunk = qMax(0, chunk - 1);
+            LogFileReader::Range range = index.chunkRange(firstChunk, m_count, reader.size());
+            window.batch = LogFileReader::parseLines(reader.data() + range.first, range.second - range.first);
+            window.firstLine = (qint64)firstChunk * index.stride();
+            window.end = range.second;
+            window.fileSize = reader.size();
+            window.loaded = true;
+        }
+        m_future.reportResult(window);
+        m_future.reportFinished();
+    }
+
+private:
+    QFutureInterface<LogFileIndex::Window> m_future;
+    QString m_path;
+    bool m_byTime;
+    qint64 m_target;
+    int m_count;
+};
+
+} //namespace
+
+LogFileIndex::LogFileIndex(const QString &logPath) :
+    m_logPath(logPath), m_stride(index_stride)
+{
+}
+
+QFuture<LogFileIndex::Window> LogFileIndex::loadWindow(const QString &path, bool byTime, qint64 target,
+                                                       int count, QThreadPool *pool)
+{
+    LoadWindowTask* task = new LoadWindowTask(path, byTime, target, count);
+    QFuture<Window> future = task->start();
+    pool->start(task);
+    return future;
+}
+
+bool LogFileIndex::update(const LogFileReader &reader, QFutureInterfaceBase *future)
+{
+    qint64 modified = QFileInfo(m_logPath).lastModified().toMSecsSinceEpoch();
+    if(load() && m_fileSize == reader.size() && m_modified == modified) return true;
+
+    // файл только дописан: начало то же, а проиндексированная часть кончается целой строкой
+    bool grown = !m_entries.isEmpty() && reader.size() > m_fileSize && m_end <= reader.size()
+                 && m_headSize <= reader.size()
+                 && qChecksum(reader.data(), uint(m_headSize)) == m_headChecksum
+                 && reader.data()[m_end - 1] == '\n';
+    if(!grown)
+        reset(reader);
+    if(!scan(reader, future)) return false;
+    m_fileSize = reader.size();
+    m_modified = modified;
+    save();
+    return true;
+}
+
+int LogFileIndex::chunkOfLine(qint64 line) const
+{
+    if(m_entries.isEmpty()) return 0;
+    return int(qBound<qint64>(0, line / m_stride, m_entries.size() - 1));
+}
+
+int LogFileIndex::chunkOfTime(qint64 timestamp) const
+{
+    auto it = std::lower_bound(m_entries.constBegin(), m_entries.constEnd(), timestamp,
+                               [](const Entry& entry, qint64 time){ return entry.timestamp < time; });
+    return qMax(0, int(it - m_entries.constBegin()) - 1);
+}
+
+LogFileReader::Range LogFileIndex::chunkRange(int first, int count, qint64 fileSize) const
+{
+    if(first >= m_entries.size()) return {fileSize, fileSize};
+    int last = first + count;
+    return {m_entries.at(first).offset, last < m_entries.size() ? m_entries.at(last).offset : fileSize};
+}
+
+bool LogFileIndex::load()
+{
+    QFile file(indexPath(m_logPath));
+    if(!file.open(QFile::ReadOnly)) return false;
+    QDataStream in(&file);
+    quint32 magic = 0, version = 0;
+    qint32 stride = 0, count = 0;
+    in >> magic >> version >> stride;
+    if(magic != index_magic || version != index_version || stride != m_stride) return false;
+    in >> m_fileSize >> m_modified >> m_headSize >> m_headChecksum >> m_end >> m_lineCount >> count;
+    if(in.status() != QDataStream::Ok || count < 0) return false;
+    m_entries.resize(count);
+    for(Entry& entry : m_entries)
+        in >> entry.offset >> entry.timestamp;
+    if(in.status() != QDataStream::Ok){
+        m_entries.clear();
+        return false;
+    }
+    return true;
+}
+
+void LogFileIndex::save() const
+{
+    // индекс заменяется целиком: другой процесс не увидит его недописанным
+    QSaveFile file(indexPath(m_logPath));
+    if(!file.open(QFile::WriteOnly)) return;
+    QDataStream out(&file);
+    out << index_magic << index_version << qint32(m_stride);
+    out << m_fileSize << m_modified << m_headSize << m_headChecksum << m_end << m_lineCount
+        << qint32(m_entries.size());
+    for(const Entry& entry : m_entries)
+        out << entry.offset << entry.timestamp;
+    file.commit();
+}
+
+void LogFileIndex::reset(const LogFileReader &reader)
+{
+    m_entries.clear();
+    m_lineCount = 0;
+    m_end = reader.dataBegin();
+    m_headSize = int(qMin<qint64>(index_head_size, reader.size()));
+    m_headChecksum = qChecksum(reader.data(), uint(m_headSize));
+}
+
+bool LogFileIndex::scan(const LogFileReader &reader, QFutureInterfaceBase *future)
+{
+    const char* data = reader.data();
+    const char* end = data + reader.size();
+    const char* p = data + m_end;
+    const char* report = p + index_progress_bytes;
+    if(future)
+        future->setProgressRange(int(m_end >> 20), int(reader.size() >> 20));
+    while(p < end)
+    {
+        if(future && p >= report)
+        {
+            if(future->isCanceled()) return false;
+            future->setProgressValue(int((p - data) >> 20));
+            report = p + index_progress_bytes;
+        }
+        const char* newline = LogFileReader::findNewline(p, end);
+        if(newline == end) break;
+        // строки считаются так же, как их загружает LogFileReader::parseLines
+        const char* lineEnd = newline;
+        if(lineEnd > p && lineEnd[-1] == '\r')
+            lineEnd--;
+        if(lineEnd > p)
+        {
+            if(m_lineCount % m_stride == 0)
+                m_entries.append({qint64(p - data), chunkTimestamp(p, end)});
+            m_lineCount++;
+        }
+        p = newline + 1;
+    }
+    m_end = p - data;
+    return true;
+}
+
+qint64 LogFileIndex::chunkTimestamp(const char *p, const char *end) const
+{
+    // разбирается только начало куска - до первой строки с заголовком
+    for(int i = 0; i < m_stride && p < end; i++)
+    {
+        const char* newline = LogFileReader::findNewline(p, end);
+        LogHistory::Batch line = LogFileReader::parseLines(p, newline - p);
+        if(!line.lines.isEmpty() && !(line.lines.first().flags & LogHistory::OnlyMessage))
+            return line.lines.first().timestamp;
+        p = newline == end ? end : newline + 1;
+    }
+    return m_entries.isEmpty() ? 0 : m_entries.last().timestamp;
+}
@@ -0,0 +1,107 @@
+#ifndef LOGFILEINDEX_H
+#define LOGFILEINDEX_H
+
+#include "LogFileReader.h"
+#include "qfuture.h"
+#include "qstring.h"
+#include "qvector.h"
+
+class QFutureInterfaceBase;
+class QThreadPool;
+
+
+namespace Logging {
+
+/*!
+ * \brief The LogFileIndex class разреженный индекс файла логов для перехода к строке или времени
+ *  без чтения всего файла. Хранится рядом с файлом (path + ".idx"): положение каждой
+ *  stride()-й строки и время первой строки каждого такого куска.
+ *  Строки нумеруются с 0, как их загружает LogFileReader: пустые строки не считаются.
+ *  Индекс проверяется по размеру и времени изменения файла (и по его началу): если файл
+ *  только дописан, индексируются лишь новые строки, иначе индекс строится заново.
+ *  Недописанная последняя строка (без '\n') индексируется при следующем обновлении.
+ */
+class LogFileIndex
+{
+public:
+    struct Entry
+    {
+        qint64 offset;    // начало первой строки куска в файле
+        qint64 timestamp; // время первой разобранной строки куска (нет таких - время предыдущего куска)
+    };
+
+    /*!
+     * \brief The Window struct строки файла вокруг искомой: загруженные куски индекса
+     */
+    struct Window
+    {
+        bool loaded = false;     // файл открыт и проиндексирован
+        qint64 fileSize = 0;
+        qint64 firstLine = 0;    // номер первой строки batch в файле
+        qint64 end = 0;          // смещение конца batch в файле: end == fileSize - окно с концом файла
+        LogHistory::Batch batch;
+    };
+
+    explicit LogFileIndex(const QString& logPath);
+
+    /*!
+     * \brief loadWindow задачей пула pool обновляет индекс файла path и разбирает count кусков,
+     *  начиная с куска перед строкой line (или перед первой строкой со временем не раньше
+     *  timestamp, byTime): над искомой строкой видно предшествующие.
+     *  Прогресс future - мегабайты индексируемого файла, отмена прерывает индексирование
+     */
+    static QFuture<Window> loadWindow(const QString& path, bool byTime, qint64 target, int count,
+                                      QThreadPool* pool);
+
+    static QString indexPath(const QString& logPath) { return logPath + ".idx"; }
+
+    /*!
+     * \brief update читает индекс с диска, дополняет или перестраивает его по содержимому reader
+     *  (открытый файл logPath) и сохраняет. Если .idx записать нельзя, индекс остается в памяти.
+     *  future (если есть) получает прогресс и может прервать обновление - тогда возвращается false
+     */
+    bool update(const LogFileReader& reader, QFutureInterfaceBase* future = nullptr);
+
+    bool isEmpty() const { return m_entries.isEmpty(); }
+    int stride() const { return m_stride; }
+    qint64 lineCount() const { return m_lineCount; }
+    const QVector<Entry>& entries() const { return m_entries; }
+    /*!
+     * \brief chunkOfLine кусок, в котором строка line (последний, если строк меньше)
+     */
+    int chunkOfLine(qint64 line) const;
+    /*!
+     * \brief chunkOfTime последний кусок, начинающийся раньше timestamp: первая строка
+     *  со временем не раньше timestamp находится в нем или дальше. Двоичный поиск
+     */
+    int chunkOfTime(qint64 timestamp) const;
+    /*!
+     * \brief chunkRange байты count кусков начиная с first (последний кусок - до fileSize)
+     */
+    LogFileReader::Range chunkRange(int first, int count, qint64 fileSize) const;
+
+private:
+    bool load();
+    void save() const;
+    void reset(const LogFileReader& reader);
+    /*!
+     * \brief scan индексирует целые строки reader от m_end, false - прервано через future
+     */
+    bool scan(const LogFileReader& reader, QFutureInterfaceBase* future);
+    qint64 chunkTimestamp(const char* p, const char* end) const;
+
+    QString m_logPath;
+    int m_stride;
+    qint64 m_fileSize = 0;  // размер и время изменения файла при последнем обновлении
+    qint64 m_modified = 0;
+    int m_headSize = 0;     // контрольная сумма начала файла: дописанный файл - тот же
+    quint16 m_headChecksum = 0;
+    qint64 m_end = 0;       // конец проиндексированных целых строк
+    qint64 m_lineCount = 0;
+    QVector<Entry> m_entries;
+};
+
+} //namespace Logging
+
+
+#endif // LOGFILEINDEX_H
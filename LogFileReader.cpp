@@ -0,0 +1,210 @@
+#include "LogFileReader.h"
+#include "LogConsoleWidget.h"
+#include "LogLineParser.h"
+#include "LoggingConcurrent.h"
+#include "LoggingEncoder.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOGFILEREADER_SSE2
+#endif
+
+using namespace Logging;
+
+const int average_line_size = 96; // для оценки числа строк диапазона
+
+namespace {
+
+/*!
+ * \brief appendLine разбирает одну строку файла (без '\n') и дописывает ее в пачку.
+ *  decoded - буфер расшифровки, общий для строк диапазона
+ */
+void appendLine(LogHistory::Batch& batch, LogLineParser& parser, QByteArray& decoded, const char* p, int size)
+{
+    if(Encoder::decodeLine(p, size, decoded)){
+        if(!decoded.isEmpty()){
+            p = decoded.constData();
+            size = decoded.size();
+        }
+    }
+
+    LogLine header;
+    int separator = QByteArray::fromRawData(p, size).indexOf(" >> "); // разделитель заголовка и сообщения
+    bool parsed = separator >= 0 && parser.parseHeader(p, separator, header);
+
+    LogHistory::Batch::Line line;
+    line.textOffset = (quint32)batch.text.size();
+    if(parsed){
+        line.timestamp = header.timestamp;
+        line.type = (quint8)header.type;
+        line.flags = 0;
+        line.functionId = header.functionId;
+        line.categoryId = header.categoryId;
+        batch.text.append(p + separator + 4, size - separator - 4);
+    }
+    else{
+        // ошибка разбора или расшифровки
+        line.timestamp = 0;
+        line.type = (quint8)QtWarningMsg;
+        line.flags = LogHistory::OnlyMessage;
+        line.functionId = 0;
+        line.categoryId = 0;
+        batch.text.append("LogLine decoding Error: ");
+        batch.text.append(p, size);
+    }
+    line.textSize = (quint32)batch.text.size() - line.textOffset;
+    batch.lines.append(line);
+
+    if(batch.functions.isEmpty() || batch.functions.last() != line.functionId)
+        batch.functions.append(line.functionId);
+}
+
+} //namespace
+
+
+LogFileReader::LogFileReader(const QString &path) :
+    m_file(path)
+{
+}
+
+LogFileReader::~LogFileReader()
+{
+    close();
+}
+
+bool LogFileReader::open()
+{
+    close();
+    if(!m_file.open(QFile::ReadOnly)) return false;
+    m_size = m_file.size();
+    if(!m_size) return true;
+    m_mapped = m_file.map(0, m_size);
+    if(m_mapped)
+        m_data = reinterpret_cast<const char*>(m_mapped);
+    else{
+        m_buffer = m_file.readAll();
+        m_size = m_buffer.size();
+        m_data = m_buffer.constData();
+    }
+    return true;
+}
+
+void LogFileReader::close()
+{
+    if(m_mapped)
+        m_file.unmap(m_mapped);
+    m_mapped = nullptr;
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_file.close();
+}
+
+qint64 LogFileReader::dataBegin() const
+{
+    // метка порядка байт UTF-8 в начале файла - не часть первой строки
+    return (m_size >= 3 && !memcmp(m_data, "\xEF\xBB\xBF", 3)) ? 3 : 0;
+}
+
+qint64 LogFileReader::tailStart(int lines) const
+{
+    const char* begin = m_data + dataBegin();
+    const char* p = m_data + m_size;
+    // '\n' в конце файла завершает последнюю строку, а не начинает новую
+    if(p > begin && p[-1] == '\n')
+        p--;
+    for(int i = 0; i < lines; i++)
+    {
+        const char* newline = findLastNewline(begin, p);
+        if(newline == p) return dataBegin();
+        p = newline;
+    }
+    return p + 1 - m_data;
+}
+
+QVector<LogFileReader::Range> LogFileReader::splitRanges(qint64 from, qint64 to, qint64 rangeSize) const
+{
+    QVector<Range> ranges;
+    const char* end = m_data + to;
+    while(from < to)
+    {
+        qint64 next = to;
+        if(to - from > rangeSize)
+        {
+            const char* newline = findNewline(m_data + from + rangeSize, end);
+            next = newline == end ? to : newline - m_data + 1;
+        }
+        ranges.append({from, next});
+        from = next;
+    }
+    return ranges;
+}
+
+LogHistory::Batch LogFileReader::parseRange(const Range &range) const
+{
+    return parseLines(m_data + range.first, range.second - range.first);
+}
+
+QFuture<LogHistory::Batch> LogFileReader::parseRanges(const QSharedPointer<LogFileReader> &reader,
+                                                       const QVector<Range> &ranges, QThreadPool *pool)
+{
+    // задачи держат reader, пока не завершится последняя
+    std::function<LogHistory::Batch(const Range&)> parse = [reader](const Range& range){
+        return reader->parseRange(range);
+    };
+    return Concurrent::mapped(pool, ranges, parse);
+}
+
+LogHistory::Batch LogFileReader::parseLines(const char *data, qint64 size)
+{
+    LogHistory::Batch batch;
+    LogLineParser parser;
+    QByteArray decoded;
+    batch.lines.reserve(int(size / average_line_size));
+    batch.text.reserve(int(size));
+    const char* end = data + size;
+    for(const char* p = data; p < end; )
+    {
+        const char* newline = findNewline(p, end);
+        const char* lineEnd = newline;
+        if(lineEnd > p && lineEnd[-1] == '\r')
+            lineEnd--;
+        if(lineEnd > p)
+            appendLine(batch, parser, decoded, p, int(lineEnd - p));
+        p = newline == end ? end : newline + 1;
+    }
+    return batch;
+}
+
+const char *LogFileReader::findNewline(const char *from, const char *end)
+{
+#ifdef LOGFILEREADER_SSE2
+    const __m128i newline = _mm_set1_epi8('\n');
+    for(; end - from >= 16; from += 16)
+    {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(from)), newline));
+        if(mask)
+            return from + qCountTrailingZeroBits(quint32(mask));
+    }
+#endif
+    const void* found = memchr(from, '\n', size_t(end - from));
+    return found ? static_cast<const char*>(found) : end;
+}
+
+const char *LogFileReader::findLastNewline(const char *from, const char *end)
+{
+    const char* p = end;
+#ifdef LOGFILEREADER_SSE2
+    const __m128i newline = _mm_set1_epi8('\n');
+    for(; p - from >= 16; p -= 16)
+    {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p - 16)), newline));
+        if(mask)
+            return p - 16 + (31 - qCountLeadingZeroBits(quint32(mask)));
+    }
+#endif
+    while(p > from)
+        if(*--p == '\n') return p;
+    return end;
+}
@@ -0,0 +1,91 @@
+#ifndef LOGFILEREADER_H
+#define LOGFILEREADER_H
+
+#include "LogHistory.h"
+#include "qfile.h"
+#include "qfuture.h"
+#include "qpair.h"
+#include "qsharedpointer.h"
+#include "qvector.h"
+
+class QThreadPool;
+
+
+namespace Logging {
+
+/*!
+ * \brief The LogFileReader class чтение файла логов для загрузки в историю.
+ *  Файл отображается в память (QFile::map) и не копируется: границы строк ищутся
+ *  векторным поиском '\n' (SSE2, 16 байт за сравнение), файл делится на диапазоны байт
+ *  по границам строк, и диапазоны разбираются параллельно в LogHistory::Batch.
+ *  Сообщения остаются в UTF-8, заголовки строк разбираются в байтах (LogLineParser).
+ *  Если отобразить файл нельзя, он читается в память целиком.
+ *  Конец файла находится поиском '\n' с конца (tailStart): последние строки можно показать сразу.
+ */
+class LogFileReader
+{
+public:
+    typedef QPair<qint64, qint64> Range; // [начало, конец) в байтах
+
+    explicit LogFileReader(const QString& path);
+    ~LogFileReader();
+
+    bool open();
+    void close();
+    const char* data() const { return m_data; }
+    qint64 size() const { return m_size; }
+
+    /*!
+     * \brief dataBegin начало первой строки (после метки порядка байт UTF-8, если она есть)
+     */
+    qint64 dataBegin() const;
+    /*!
+     * \brief tailStart начало последних lines строк файла (пустые строки тоже считаются)
+     */
+    qint64 tailStart(int lines) const;
+    /*!
+     * \brief splitRanges делит [from, to) на диапазоны примерно по rangeSize байт. from - начало строки,
+     *  каждый диапазон заканчивается после '\n' (последний - в to)
+     */
+    QVector<Range> splitRanges(qint64 from, qint64 to, qint64 rangeSize) const;
+    /*!
+     * \brief parseRange разбирает строки диапазона. Можно вызывать из разных потоков одновременно
+     */
+    LogHistory::Batch parseRange(const Range& range) const;
+    /*!
+     * \brief parseRanges разбирает диапазоны задачами пула pool, по одной на диапазон.
+     *  Результат i - диапазон ranges[i], он доступен сразу по готовности (QFutureWatcher::resultReadyAt).
+     *  Задачи ставятся в очередь пула в порядке ranges, освободившийся поток берет следующую,
+     *  поэтому медленный диапазон не задерживает остальные. Отмена future пропускает не начатые
+     *  диапазоны. reader остается открытым, пока не завершится последняя задача
+     */
+    static QFuture<LogHistory::Batch> parseRanges(const QSharedPointer<LogFileReader>& reader,
+                                                  const QVector<Range>& ranges, QThreadPool* pool);
+
+    /*!
+     * \brief parseLines разбирает строки data[0, size). Пустые строки пропускаются, "\r\n" допускается.
+     *  Зашифрованные строки (LoggingEncoder) расшифровываются, неразобранные становятся
+     *  предупреждениями "LogLine decoding Error: ..."
+     */
+    static LogHistory::Batch parseLines(const char* data, qint64 size);
+    /*!
+     * \brief findNewline первый '\n' в [from, end), end - если его нет
+     */
+    static const char* findNewline(const char* from, const char* end);
+    /*!
+     * \brief findLastNewline последний '\n' в [from, end), end - если его нет
+     */
+    static const char* findLastNewline(const char* from, const char* end);
+
+private:
+    QFile m_file;
+    const char* m_data = nullptr;
+    qint64 m_size = 0;
+    uchar* m_mapped = nullptr;
+    QByteArray m_buffer; // содержимое файла, если отобразить его в память не удалось
+};
+
+} //namespace Logging
+
+
+#endif // LOGFILEREADER_H
@@ -0,0 +1,363 @@
+#include "LogHistory.h"
+#include "LogConsoleWidget.h"
+#include <QtMath>
+#include <limits>
+
+using namespace Logging;
+
+const int text_chunk_size = 1024 * 1024; // размер блока текста сообщений
+const int initial_capacity = 1024;       // начальный размер кольцевых буферов колонок
+
+namespace {
+
+// копирует колонку из кольцевого буфера в начало нового буфера размера capacity
+template<typename T>
+void moveColumn(QVector<T>& column, int head, int count, int capacity)
+{
+    QVector<T> moved(capacity);
+    for(int i = 0; i < count; i++)
+        moved[i] = column.at((head + i) & (column.size() - 1));
+    column.swap(moved);
+}
+
+} //namespace
+
+LogHistory::LogHistory()
+{
+}
+
+void LogHistory::setLimits(int maxLines, qint64 maxBytes)
+{
+    m_maxLines = qMax(0, maxLines);
+    m_maxBytes = qMax<qint64>(0, maxBytes);
+    evictToLimits();
+    // буфер, выросший до снижения ограничения, ужимается
+    if(m_maxLines && m_timestamps.size() > 2 * (int)qNextPowerOfTwo((quint32)qMax(m_maxLines, initial_capacity)))
+        reallocate((int)qNextPowerOfTwo((quint32)qMax(m_maxLines, initial_capacity)));
+}
+
+void LogHistory::append(const LogLine &line)
+{
+    QByteArray utf8 = line.message.toUtf8();
+    appendRecord(line.timestamp, (quint8)line.type, line.only_message ? OnlyMessage : 0,
+                 line.functionId, line.categoryId, utf8.constData(), utf8.size());
+}
+
+void LogHistory::append(const QVector<LogLine> &lines)
+{
+    for(const LogLine& line : lines)
+        append(line);
+}
+
+void LogHistory::append(const Batch &batch)
+{
+    const char* text = batch.text.constData();
+    for(const Batch::Line& line : batch.lines)
+        appendRecord(line.timestamp, line.type, line.flags, line.functionId, line.categoryId,
+                     text + line.textOffset, int(line.textSize));
+}
+
+void LogHistory::reserveFront(qint64 lines)
+{
+    if(!m_count && lines > 0)
+        m_first += lines;
+}
+
+int LogHistory::prepend(const Batch &batch)
+{
+    // добавляются последние строки пачки, пока хватает свободных номеров и ограничений
+    int skip = batch.lines.size();
+    int limit = int(qMin<qint64>(m_first, m_maxLines ? m_maxLines - m_count : std::numeric_limits<int>::max()));
+    qint64 bytes = dataSize();
+    while(skip > 0 && batch.lines.size() - skip < limit)
+    {
+        qint64 size = bytes + line_columns_size + batch.lines.at(skip - 1).textSize;
+        if(m_maxBytes && size > m_maxBytes && (m_count || skip < batch.lines.size()))
+            break;
+        bytes = size;
+        skip--;
+    }
+    int n = batch.lines.size() - skip;
+    if(!n) return 0;
+
+    if(m_count + n > m_timestamps.size())
+        reallocate(qMax(initial_capacity, (int)qNextPowerOfTwo((quint32)(m_count + n))));
+    const int mask = m_timestamps.size() - 1;
+
+    // текст добавленных строк становится блоком перед самым старым.
+    // Если строки взяты не все, копируется только их хвост текста: иначе блок
+    // держал бы в памяти весь текст пачки сверх ограничения m_maxBytes
+    quint32 base = 0;
+    QByteArray text = batch.text;
+    if(skip){
+        base = batch.lines.at(skip).textOffset;
+        text = batch.text.mid(int(base));
+    }
+    quint32 chunk;
+    if(m_chunks.isEmpty()){
+        m_chunks.append(text);
+        chunk = m_firstChunk;
+    }
+    else{
+        m_chunks.prepend(text);
+        chunk = --m_firstChunk;
+    }
+
+    // у первой строки пачки предыдущей нет: строка без времени получает время следующей за пачкой
+    qint64 previous = m_count ? m_timestamps.at(m_head) : 0;
+    qint64 minTimestamp = std::numeric_limits<qint64>::max();
+    qint64 maxTimestamp = std::numeric_limits<qint64>::min();
+    qint64 disorder = 0;
+    m_head = (m_head - n) & mask;
+    for(int k = 0; k < n; k++)
+    {
+        const Batch::Line& line = batch.lines.at(skip + k);
+        qint64 timestamp = line.timestamp;
+        if((line.flags & OnlyMessage) && !timestamp)
+            timestamp = previous;
+        if(k)
+            disorder = qMax(disorder, maxTimestamp - timestamp);
+        minTimestamp = qMin(minTimestamp, timestamp);
+        maxTimestamp = qMax(maxTimestamp, timestamp);
+        previous = timestamp;
+
+        int i = (m_head + k) & mask;
+        m_timestamps[i] = timestamp;
+        m_types[i] = line.type;
+        m_flags[i] = line.flags;
+        m_functionIds[i] = line.functionId;
+        m_categoryIds[i] = line.categoryId;
+        m_text[i] = {chunk, line.textOffset - base, line.textSize};
+        m_textSize += line.textSize;
+
+        if(line.functionId >= (quint32)m_functionLines.size())
+            m_functionLines.resize(line.functionId + 1);
+        m_functionLines[line.functionId]++;
+    }
+
+    // строки пачки идут раньше всех хранимых: отставание - от наибольшего времени пачки
+    if(m_count){
+        disorder = qMax(disorder, maxTimestamp - m_minTimestamp);
+        minTimestamp = qMin(minTimestamp, m_minTimestamp);
+        maxTimestamp = qMax(maxTimestamp, m_maxTimestamp);
+    }
+    m_timeDisorder = qMax(m_timeDisorder, disorder);
+    m_minTimestamp = minTimestamp;
+    m_maxTimestamp = maxTimestamp;
+    m_count += n;
+    m_first -= n;
+    return n;
+}
+
+void LogHistory::clear()
+{
+    m_first += m_count;
+    m_head = 0;
+    m_count = 0;
+    m_timestamps.clear();
+    m_types.clear();
+    m_flags.clear();
+    m_functionIds.clear();
+    m_categoryIds.clear();
+    m_text.clear();
+    m_chunks.clear();
+    m_firstChunk = 0;
+    m_textSize = 0;
+    m_maxTimestamp = 0;
+    m_minTimestamp = 0;
+    m_timeDisorder = 0;
+    m_functionLines.fill(0);
+    m_releasedFunctions.clear();
+}
+
+void LogHistory::reserve(int lines)
+{
+    if(m_maxLines)
+        lines = qMin(lines, m_maxLines);
+    if(lines > m_timestamps.size())
+        reallocate((int)qNextPowerOfTwo((quint32)lines));
+}
+
+LogHistory::Record LogHistory::record(qint64 index) const
+{
+    int i = slot(index);
+    const TextRef& text = m_text.at(i);
+    Record r;
+    r.timestamp = m_timestamps.at(i);
+    r.chunk = text.chunk;
+    r.textOffset = text.offset;
+    r.textSize = text.size;
+    r.functionId = m_functionIds.at(i);
+    r.categoryId = m_categoryIds.at(i);
+    r.type = m_types.at(i);
+    r.flags = m_flags.at(i);
+    return r;
+}
+
+QString LogHistory::message(qint64 index) const
+{
+    const TextRef& text = m_text.at(slot(index));
+    if(!text.size) return QString();
+    return QString::fromUtf8(m_chunks.at(int(text.chunk - m_firstChunk)).constData() + text.offset, text.size);
+}
+
+const char *LogHistory::messageUtf8(qint64 index) const
+{
+    const TextRef& text = m_text.at(slot(index));
+    return m_chunks.at(int(text.chunk - m_firstChunk)).constData() + text.offset;
+}
+
+LogLine LogHistory::line(qint64 index) const
+{
+    int i = slot(index);
+    LogLine line(QtMsgType(m_types.at(i)), m_timestamps.at(i), m_functionIds.at(i), message(index), m_categoryIds.at(i));
+    line.only_message = m_flags.at(i) & OnlyMessage;
+    return line;
+}
+
+QVector<LogLine> LogHistory::lines(qint64 from, int count) const
+{
+    QVector<LogLine> result;
+    result.reserve(count);
+    for(qint64 i = from; i < from + count; i++)
+        result.append(line(i));
+    return result;
+}
+
+void LogHistory::timeRange(qint64 fromTime, qint64 toTime, qint64 &from, qint64 &to) const
+{
+    from = qMax(from, m_first);
+    to = qMin(to, endIndex());
+    if(from >= to) return;
+    // время строк отличается от упорядоченного не больше чем на d = m_timeDisorder:
+    // t[i] - d <= t[j] для i < j. Граница двоичного поиска по "t < fromTime - d" такова,
+    // что до нее нет строк с t >= fromTime (иначе строка перед границей была бы >= fromTime - d),
+    // а граница по "t <= toTime + d" - что после нее нет строк с t <= toTime
+    const qint64 limit = std::numeric_limits<qint64>::max();
+    qint64 lower = fromTime < -limit + m_timeDisorder ? -limit : fromTime - m_timeDisorder;
+    qint64 upper = toTime > limit - m_timeDisorder ? limit : toTime + m_timeDisorder;
+    qint64 lo = from, hi = to;
+    while(lo < hi)
+    {
+        qint64 mid = lo + (hi - lo) / 2;
+        if(timestamp(mid) < lower) lo = mid + 1;
+        else hi = mid;
+    }
+    from = lo;
+    hi = to;
+    while(lo < hi)
+    {
+        qint64 mid = lo + (hi - lo) / 2;
+        if(timestamp(mid) <= upper) lo = mid + 1;
+        else hi = mid;
+    }
+    to = lo;
+}
+
+qint64 LogHistory::memoryUsage() const
+{
+    qint64 bytes = (qint64)m_timestamps.size() * line_columns_size;
+    for(const QByteArray& chunk : m_chunks)
+        bytes += chunk.capacity();
+    return bytes;
+}
+
+QVector<quint32> LogHistory::takeReleasedFunctions()
+{
+    QVector<quint32> released;
+    released.swap(m_releasedFunctions);
+    return released;
+}
+
+void LogHistory::appendRecord(qint64 timestamp, quint8 type, quint8 flags, quint32 functionId, quint32 categoryId,
+                              const char *text, int size)
+{
+    if(m_maxLines && m_count >= m_maxLines)
+        evictOldest();
+    if(m_count == m_timestamps.size())
+        reallocate(m_timestamps.isEmpty() ? initial_capacity : m_timestamps.size() * 2);
+
+    int tail = (m_head + m_count) & (m_timestamps.size() - 1);
+    // неразобранные строки (продолжения многострочных сообщений) без времени
+    // получают время предыдущей строки и не нарушают порядок
+    if((flags & OnlyMessage) && !timestamp && m_count)
+        timestamp = m_timestamps.at((tail - 1) & (m_timestamps.size() - 1));
+    if(!m_count)
+        m_maxTimestamp = m_minTimestamp = timestamp;
+    m_timeDisorder = qMax(m_timeDisorder, m_maxTimestamp - timestamp);
+    m_maxTimestamp = qMax(m_maxTimestamp, timestamp);
+    m_minTimestamp = qMin(m_minTimestamp, timestamp);
+
+    m_timestamps[tail] = timestamp;
+    m_types[tail] = type;
+    m_flags[tail] = flags;
+    m_functionIds[tail] = functionId;
+    m_categoryIds[tail] = categoryId;
+    m_text[tail] = storeText(text, size);
+    m_count++;
+
+    if(functionId >= (quint32)m_functionLines.size())
+        m_functionLines.resize(functionId + 1);
+    m_functionLines[functionId]++;
+
+    if(m_maxBytes)
+        evictToLimits();
+}
+
+LogHistory::TextRef LogHistory::storeText(const char *text, int size)
+{
+    // новый блок, если сообщение не помещается в текущий без перевыделения памяти
+    if(m_chunks.isEmpty() || m_chunks.last().capacity() - m_chunks.last().size() < size)
+    {
+        QByteArray chunk;
+        chunk.reserve(qMax(text_chunk_size, size));
+        m_chunks.append(chunk);
+    }
+    QByteArray& chunk = m_chunks.last();
+    TextRef ref;
+    ref.chunk = m_firstChunk + (quint32)(m_chunks.size() - 1);
+    ref.offset = (quint32)chunk.size();
+    ref.size = (quint32)size;
+    chunk.append(text, size);
+    m_textSize += size;
+    return ref;
+}
+
+void LogHistory::reallocate(int capacity)
+{
+    moveColumn(m_timestamps, m_head, m_count, capacity);
+    moveColumn(m_types, m_head, m_count, capacity);
+    moveColumn(m_flags, m_head, m_count, capacity);
+    moveColumn(m_functionIds, m_head, m_count, capacity);
+    moveColumn(m_categoryIds, m_head, m_count, capacity);
+    moveColumn(m_text, m_head, m_count, capacity);
+    m_head = 0;
+}
+
+void LogHistory::evictOldest()
+{
+    m_textSize -= m_text.at(m_head).size;
+    quint32 function = m_functionIds.at(m_head);
+    if(--m_functionLines[function] == 0 && function)
+        m_releasedFunctions.append(function);
+
+    m_head = (m_head + 1) & (m_timestamps.size() - 1);
+    m_count--;
+    m_first++;
+
+    // блоки до блока самой старой оставшейся строки больше не нужны (текущий блок остается)
+    quint32 keep = m_count ? m_text.at(m_head).chunk : m_firstChunk + (quint32)(m_chunks.size() - 1);
+    while(m_firstChunk != keep && m_chunks.size() > 1)
+    {
+        m_chunks.removeFirst();
+        m_firstChunk++;
+    }
+}
+
+void LogHistory::evictToLimits()
+{
+    while(m_maxLines && m_count > m_maxLines)
+        evictOldest();
+    while(m_maxBytes && m_count > 1 && dataSize() > m_maxBytes)
+        evictOldest();
+}
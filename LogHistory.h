@@ -0,0 +1,257 @@
+#ifndef LOGHISTORY_H
+#define LOGHISTORY_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <qlogging.h>
+
+
+namespace Logging {
+
+class LogLine;
+
+/*!
+ * \brief The LogHistory class компактное хранилище истории консоли.
+ *  Поля строк хранятся по колонкам (struct of arrays): время, уровень, флаги, id функции,
+ *  id категории и положение текста - каждое в своем массиве. Проходы фильтров читают
+ *  только нужные колонки: фильтр уровня и времени - 9 байт на строку подряд в памяти,
+ *  такие циклы компилятор векторизует.
+ *  Текст сообщений в UTF-8 дописывается подряд в большие блоки памяти (arena)
+ *  и никогда не перемещается.
+ *  Колонки - кольцевые буферы одного размера, а строки нумеруются сквозными номерами (индексами):
+ *  при ограничении истории (setLimits) самые старые строки вытесняются за O(1),
+ *  без сдвига и перевыделения памяти, а номера оставшихся строк не меняются.
+ *  Блок текста освобождается целиком, когда вытеснена последняя ссылающаяся на него строка.
+ *  Не потокобезопасен: LogConsoleWidget обращается к нему под m_mutex.
+ */
+class LogHistory
+{
+public:
+    /*!
+     * \brief The Record struct поля строки логов, собранные из колонок (копия, не ссылка)
+     */
+    struct Record
+    {
+        qint64 timestamp;   // локальное время в мс (см. LoggingTime.h)
+        quint32 chunk;      // сквозной номер блока текста
+        quint32 textOffset; // смещение сообщения в блоке
+        quint32 textSize;   // длина сообщения в байтах UTF-8
+        quint32 functionId; // id из FunctionTable
+        quint32 categoryId; // id из CategoryTable
+        quint8 type;        // QtMsgType
+        quint8 flags;       // RecordFlags
+    };
+    enum RecordFlags : quint8 {
+        OnlyMessage = 0x01 // строка не разобрана, хранится только текст
+    };
+    /*!
+     * \brief The Batch struct пачка строк, разобранных без перевода в UTF-16
+     *  (загрузка файлов): поля строк и тексты сообщений в UTF-8 одним буфером
+     */
+    struct Batch
+    {
+        struct Line
+        {
+            qint64 timestamp;
+            quint32 functionId;
+            quint32 categoryId;
+            quint32 textOffset; // смещение сообщения в text
+            quint32 textSize;
+            quint8 type;        // QtMsgType
+            quint8 flags;       // RecordFlags
+        };
+        QVector<Line> lines;
+        QByteArray text;
+        QVector<quint32> functions; // id функций строк (соседние повторы пропущены)
+    };
+
+    LogHistory();
+
+    /*!
+     * \brief setLimits ограничения истории: maxLines - число строк, maxBytes - размер записей
+     *  и текста сообщений в байтах (0 - без ограничения). Лишние старые строки вытесняются сразу.
+     *  Последняя добавленная строка хранится всегда, даже если одна превышает maxBytes.
+     */
+    void setLimits(int maxLines, qint64 maxBytes);
+    int maxLines() const { return m_maxLines; }
+    qint64 maxBytes() const { return m_maxBytes; }
+
+    void append(const LogLine& line);
+    void append(const QVector<LogLine>& lines);
+    void append(const Batch& batch);
+    /*!
+     * \brief reserveFront оставляет перед пустой историей lines свободных номеров для prepend(..)
+     */
+    void reserveFront(qint64 lines);
+    /*!
+     * \brief prepend добавляет пачку строк перед самой старой (догрузка истории файла с конца).
+     *  Номера новых строк идут вниз от firstIndex() и не меньше 0 (см. reserveFront).
+     *  Строки, не уместившиеся в ограничения setLimits(..), не добавляются - они и так были бы
+     *  вытеснены первыми. Возвращает число добавленных строк, это последние строки пачки
+     */
+    int prepend(const Batch& batch);
+    /*!
+     * \brief clear удаляет все строки, нумерация продолжается с endIndex()
+     */
+    void clear();
+    void reserve(int lines);
+
+    int size() const { return m_count; }
+    bool isEmpty() const { return !m_count; }
+    /*!
+     * \brief firstIndex номер самой старой хранимой строки
+     */
+    qint64 firstIndex() const { return m_first; }
+    /*!
+     * \brief endIndex номер, который получит следующая добавленная строка
+     */
+    qint64 endIndex() const { return m_first + m_count; }
+    bool contains(qint64 index) const { return index >= m_first && index < m_first + m_count; }
+
+    Record record(qint64 index) const;
+    qint64 timestamp(qint64 index) const { return m_timestamps.at(slot(index)); }
+    QtMsgType type(qint64 index) const { return QtMsgType(m_types.at(slot(index))); }
+    quint32 functionId(qint64 index) const { return m_functionIds.at(slot(index)); }
+    quint32 categoryId(qint64 index) const { return m_categoryIds.at(slot(index)); }
+
+    /*!
+     * \brief segment длина непрерывного участка колонок от index до to (не дальше конца
+     *  кольцевого буфера). Указатели колонок ниже действительны на segment(index, to) строк:
+     *
+     *  for(qint64 i = from; i < to; i += n){
+     *      n = history.segment(i, to);
+     *      const quint8* types = history.types(i);
+     *      ...
+     *  }
+     */
+    int segment(qint64 index, qint64 to) const {
+        return int(qMin<qint64>(to - index, m_timestamps.size() - slot(index)));
+    }
+    const qint64* timestamps(qint64 index) const { return m_timestamps.constData() + slot(index); }
+    const quint8* types(qint64 index) const { return m_types.constData() + slot(index); }
+    const quint32* functionIds(qint64 index) const { return m_functionIds.constData() + slot(index); }
+    const quint32* categoryIds(qint64 index) const { return m_categoryIds.constData() + slot(index); }
+
+    /*!
+     * \brief message декодирует текст сообщения (UTF-16 строится только здесь)
+     */
+    QString message(qint64 index) const;
+    /*!
+     * \brief messageUtf8 текст сообщения в UTF-8 без копирования (длина - messageSize(index)),
+     *  указатель действителен, пока строка не вытеснена
+     */
+    const char* messageUtf8(qint64 index) const;
+    int messageSize(qint64 index) const { return int(m_text.at(slot(index)).size); }
+    /*!
+     * \brief line собирает LogLine для строки index
+     */
+    LogLine line(qint64 index) const;
+    /*!
+     * \brief lines собирает LogLine для строк [from, from + count)
+     */
+    QVector<LogLine> lines(qint64 from, int count) const;
+
+    /*!
+     * \brief timeRange сужает [from, to) до строк, среди которых могут быть строки со временем
+     *  в [fromTime, toTime]: вне диапазона таких строк нет. Двоичный поиск, O(log n).
+     *  Строки добавляются почти по порядку времени (из разных потоков, склеенные файлы):
+     *  поиск ведется с запасом timeDisorder(), поэтому внутри диапазона время строк
+     *  все равно нужно проверять.
+     */
+    void timeRange(qint64 fromTime, qint64 toTime, qint64& from, qint64& to) const;
+    /*!
+     * \brief timeDisorder насколько (мс) время строки может быть меньше времени строк до нее,
+     *  0 - строки упорядочены по времени
+     */
+    qint64 timeDisorder() const { return m_timeDisorder; }
+
+    /*!
+     * \brief memoryUsage память, занятая колонками и блоками текста, в байтах
+     */
+    qint64 memoryUsage() const;
+    /*!
+     * \brief dataSize размер хранимых строк (колонки + текст), с ним сравнивается maxBytes
+     */
+    qint64 dataSize() const { return m_textSize + (qint64)m_count * line_columns_size; }
+    /*!
+     * \brief textSize суммарная длина сообщений в байтах UTF-8
+     */
+    qint64 textSize() const { return m_textSize; }
+
+    /*!
+     * \brief functionLines число хранимых строк функции
+     */
+    int functionLines(quint32 function) const {
+        return function < (quint32)m_functionLines.size() ? m_functionLines.at(function) : 0;
+    }
+    /*!
+     * \brief takeReleasedFunctions забирает id функций, все строки которых были вытеснены
+     *  (с последнего вызова). Функция могла снова появиться - проверяйте functionLines(..)
+     */
+    QVector<quint32> takeReleasedFunctions();
+
+private:
+    /*!
+     * \brief The TextRef struct положение сообщения в блоках текста
+     */
+    struct TextRef
+    {
+        quint32 chunk;  // сквозной номер блока текста
+        quint32 offset; // смещение сообщения в блоке
+        quint32 size;   // длина сообщения в байтах UTF-8
+    };
+    static const int line_columns_size = sizeof(qint64) + 2 * sizeof(quint8) + 2 * sizeof(quint32) + sizeof(TextRef);
+
+    inline int slot(qint64 index) const {
+        return (m_head + int(index - m_first)) & (m_timestamps.size() - 1);
+    }
+    /*!
+     * \brief appendRecord добавляет строку в колонки, текст сообщения - UTF-8
+     */
+    void appendRecord(qint64 timestamp, quint8 type, quint8 flags, quint32 functionId, quint32 categoryId,
+                      const char* text, int size);
+    /*!
+     * \brief storeText копирует текст в текущий блок (или заводит новый) и возвращает его положение
+     */
+    TextRef storeText(const char* text, int size);
+    /*!
+     * \brief reallocate переносит колонки в кольцевые буферы размера capacity (степень двойки)
+     */
+    void reallocate(int capacity);
+    /*!
+     * \brief evictOldest вытесняет самую старую строку и освобождает ставшие ненужными блоки текста
+     */
+    void evictOldest();
+    void evictToLimits();
+
+    // колонки - кольцевые буферы одного размера (степень двойки)
+    QVector<qint64> m_timestamps;
+    QVector<quint8> m_types;
+    QVector<quint8> m_flags;
+    QVector<quint32> m_functionIds;
+    QVector<quint32> m_categoryIds;
+    QVector<TextRef> m_text;
+    int m_head = 0;             // слот самой старой строки
+    int m_count = 0;
+    qint64 m_first = 0;         // номер самой старой строки
+    QList<QByteArray> m_chunks; // блоки текста, m_chunks[0] имеет номер m_firstChunk
+    quint32 m_firstChunk = 0;
+    qint64 m_textSize = 0;
+
+    int m_maxLines = 0;
+    qint64 m_maxBytes = 0;
+
+    qint64 m_maxTimestamp = 0;    // наибольшее время добавленных строк (с последнего clear)
+    qint64 m_minTimestamp = 0;    // наименьшее - для строк, добавляемых в начало
+    qint64 m_timeDisorder = 0;    // наибольшее отставание времени строки от m_maxTimestamp
+
+    QVector<int> m_functionLines; // число хранимых строк по id функции
+    QVector<quint32> m_releasedFunctions;
+};
+
+} //namespace Logging
+
+
+#endif // LOGHISTORY_H
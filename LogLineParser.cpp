@@ -0,0 +1,177 @@
+#include "LogLineParser.h"
+#include "LogConsoleWidget.h"
+#include "LoggingTime.h"
+#include <cstring>
+
+using namespace Logging;
+
+const qint64 msecs_per_day = 86400000;
+const int time_size = 12;          // "hh:mm:ss.zzz"
+const int max_qstring_header = 256; // заголовки QString длиннее разбираются через LogLine::parseHeader
+
+namespace {
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/*!
+ * \brief matches сверяет текст с шаблоном, 'd' в шаблоне - любая цифра
+ */
+inline bool matches(const char* p, const char* pattern, int size)
+{
+    for(int i = 0; i < size; i++)
+        if(pattern[i] == 'd' ? !isDigit(p[i]) : p[i] != pattern[i]) return false;
+    return true;
+}
+
+inline int number(const char* p, int size)
+{
+    int value = 0;
+    for(int i = 0; i < size; i++)
+        value = value * 10 + (p[i] - '0');
+    return value;
+}
+
+/*!
+ * \brief equalsUpper p совпадает с upper (заглавные ASCII) без учета регистра
+ */
+inline bool equalsUpper(const char* p, const char* upper, int size)
+{
+    for(int i = 0; i < size; i++)
+        if((p[i] & ~0x20) != upper[i]) return false;
+    return true;
+}
+
+/*!
+ * \brief levelOf уровень по имени из msgTypeToString (без учета регистра), false - другое имя
+ */
+inline bool levelOf(const char* p, int size, QtMsgType& type)
+{
+    switch(size){
+    case 4:
+        type = QtInfoMsg;
+        return equalsUpper(p, "INFO", 4);
+    case 5:
+        if((p[0] & ~0x20) == 'D'){
+            type = QtDebugMsg;
+            return equalsUpper(p, "DEBUG", 5);
+        }
+        type = QtFatalMsg;
+        return equalsUpper(p, "FATAL", 5);
+    case 7:
+        type = QtWarningMsg;
+        return equalsUpper(p, "WARNING", 7);
+    case 8:
+        type = QtCriticalMsg;
+        return equalsUpper(p, "CRITICAL", 8);
+    }
+    return false;
+}
+
+/*!
+ * \brief nextToken следующее слово [from, to) после пробелов (пустые части пропускаются, как в split)
+ */
+inline bool nextToken(const char*& p, const char* end, const char*& from, const char*& to)
+{
+    while(p < end && *p == ' ')
+        p++;
+    if(p == end) return false;
+    from = p;
+    while(p < end && *p != ' ')
+        p++;
+    to = p;
+    return true;
+}
+
+} //namespace
+
+
+LogLineParser::LogLineParser()
+{
+    memset(m_date, 0, sizeof(m_date));
+}
+
+bool LogLineParser::parseHeader(const char *header, int size, LogLine &line)
+{
+    const char* end = header + size;
+    // быстрый путь - дата и время ровно в формате LogLine::toQString и по одному пробелу после них
+    if(size <= date_size + time_size + 2
+        || !matches(header, "dddd-dd-dd ", date_size + 1)
+        || !matches(header + date_size + 1, "dd:dd:dd.ddd ", time_size + 1))
+        return line.parseHeader(QString::fromUtf8(header, size));
+
+    const char* p = header + date_size + time_size + 2;
+    const char* level;
+    const char* levelEnd;
+    if(!nextToken(p, end, level, levelEnd)) return false;
+
+    if(memcmp(header, m_date, date_size))
+    {
+        memcpy(m_date, header, date_size);
+        m_day = Time::daysFromCivil(number(header, 4), number(header + 5, 2), number(header + 8, 2));
+    }
+    const char* time = header + date_size + 1;
+    line.timestamp = m_day * msecs_per_day
+                     + ((number(time, 2) * 60 + number(time + 3, 2)) * 60 + number(time + 6, 2)) * 1000LL
+                     + number(time + 9, 3);
+
+    if(!levelOf(level, int(levelEnd - level), line.type))
+        line.type = StringToMsgType(QString::fromUtf8(level, int(levelEnd - level)));
+
+    // функция - четвертое слово, последним может идти категория в квадратных скобках
+    line.functionId = 0;
+    line.categoryId = 0;
+    const char* function;
+    const char* functionEnd;
+    if(!nextToken(p, end, function, functionEnd)) return true;
+    const char* last = function;
+    const char* lastEnd = functionEnd;
+    int count = 4;
+    while(nextToken(p, end, last, lastEnd))
+        count++;
+    int lastSize = int(lastEnd - last);
+    bool hasCategory = lastSize > 2 && last[0] == '[' && lastEnd[-1] == ']';
+    if(hasCategory)
+        line.categoryId = categoryId(last + 1, lastSize - 2);
+    if(count >= 5 || !hasCategory)
+        line.functionId = functionId(function, int(functionEnd - function));
+    return true;
+}
+
+bool LogLineParser::parseHeader(const QChar *header, int size, LogLine &line)
+{
+    char ascii[max_qstring_header];
+    bool fits = size <= max_qstring_header;
+    for(int i = 0; fits && i < size; i++)
+    {
+        ushort c = header[i].unicode();
+        fits = c < 0x80;
+        ascii[i] = char(c);
+    }
+    if(!fits)
+        return line.parseHeader(QString(header, size));
+    return parseHeader(ascii, size, line);
+}
+
+quint32 LogLineParser::functionId(const char *name, int size)
+{
+    // ключ поиска ссылается на байты строки без копирования
+    auto it = m_functions.constFind(QByteArray::fromRawData(name, size));
+    if(it != m_functions.constEnd())
+        return it.value();
+    quint32 id = FunctionTable::intern(QString::fromUtf8(name, size));
+    m_functions.insert(QByteArray(name, size), id);
+    return id;
+}
+
+quint32 LogLineParser::categoryId(const char *name, int size)
+{
+    auto it = m_categories.constFind(QByteArray::fromRawData(name, size));
+    if(it != m_categories.constEnd())
+        return it.value();
+    quint32 id = CategoryTable::intern(QString::fromUtf8(name, size));
+    m_categories.insert(QByteArray(name, size), id);
+    return id;
+}
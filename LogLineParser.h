@@ -0,0 +1,54 @@
+#ifndef LOGLINEPARSER_H
+#define LOGLINEPARSER_H
+
+#include "qbytearray.h"
+#include "qhash.h"
+
+
+namespace Logging {
+
+class LogLine;
+
+/*!
+ * \brief The LogLineParser class быстрый разбор заголовка строки логов
+ *  "yyyy-MM-dd hh:mm:ss.zzz LEVEL func [category]" (часть до " >> ") прямо в байтах UTF-8.
+ *  Один проход без QString и QStringList: дата и время проверяются по шаблону
+ *  и собираются из цифр арифметикой, уровень определяется по длине и первой букве.
+ *  Дата предыдущей строки запоминается: для строк того же дня номер дня не пересчитывается.
+ *  Имена функций и категорий переводятся в id через свой кеш, таблицы FunctionTable
+ *  и CategoryTable (мьютекс, QString) затрагиваются только для новых имен.
+ *  Заголовки другого вида разбираются прежним LogLine::parseHeader(QString), поэтому
+ *  результат всегда совпадает с ним.
+ *  Хранит состояние: у каждого потока (задачи разбора) свой экземпляр.
+ */
+class LogLineParser
+{
+public:
+    LogLineParser();
+
+    /*!
+     * \brief parseHeader заполняет время, уровень, функцию и категорию line.
+     *  false - это не заголовок (как у LogLine::parseHeader)
+     */
+    bool parseHeader(const char* header, int size, LogLine& line);
+    /*!
+     * \brief parseHeader то же для заголовка в QString: ASCII заголовок
+     *  копируется в буфер на стеке, остальные разбираются LogLine::parseHeader
+     */
+    bool parseHeader(const QChar* header, int size, LogLine& line);
+
+private:
+    quint32 functionId(const char* name, int size);
+    quint32 categoryId(const char* name, int size);
+
+    static const int date_size = 10; // "yyyy-MM-dd"
+    char m_date[date_size];          // дата предыдущей строки
+    qint64 m_day = 0;                // ее номер дня от 1970-01-01
+    QHash<QByteArray, quint32> m_functions;
+    QHash<QByteArray, quint32> m_categories;
+};
+
+} //namespace Logging
+
+
+#endif // LOGLINEPARSER_H
@@ -0,0 +1,651 @@
+#include "LogLinesDisplayWidget.h"
+#include "LogConsoleWidget.h"
+#include "LogHistory.h"
+#include "LoggingConcurrent.h"
+#include "qapplication.h"
+#include "qclipboard.h"
+#include "qevent.h"
+#include "qmenu.h"
+#include "qmimedata.h"
+#include "qpainter.h"
+#include "qscrollbar.h"
+#include "qtextcursor.h"
+#include "qtextdocument.h"
+#include "qtextobject.h"
+#include <QtMath>
+#include <algorithm>
+
+using namespace Logging;
+
+const int text_margin = 4; // отступ текста от левого края
+const int copy_block_rows = 2000; // строк выделения в одной задаче форматирования
+const int rich_copy_rows = 20000; // больше строк копируется только текстом
+
+LogLinesDisplayWidget::LogLinesDisplayWidget(QWidget *parent) :
+    QAbstractScrollArea(parent)
+{
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setCursor(Qt::IBeamCursor);
+    verticalScrollBar()->setSingleStep(1);
+    setTextFont(font());
+
+    // окно "прилипает" к концу, пока пользователь не прокрутит его вверх
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value){
+        m_stickToBottom = value >= verticalScrollBar()->maximum();
+    });
+}
+
+LogLinesDisplayWidget::~LogLinesDisplayWidget()
+{
+}
+
+void LogLinesDisplayWidget::setSource(const LogHistory *history, ConsoleFormatter *formatter)
+{
+    m_history = history;
+    m_formatter = formatter;
+    invalidateLayouts();
+    viewport()->update();
+}
+
+void LogLinesDisplayWidget::setRows(const QVector<qint64> &rows)
+{
+    bool stick = m_stickToBottom;
+    m_rows = rows;
+    m_rowsBegin = 0;
+    m_selectionAnchor = m_selectionCursor = TextPosition();
+    m_maxLineWidth = 0;
+    invalidateLayouts();
+    updateScrollBars();
+    if(stick)
+        scrollToBottom();
+    viewport()->update();
+}
+
+void LogLinesDisplayWidget::appendRows(const QVector<qint64> &rows)
+{
+    if(rows.isEmpty()) return;
+    bool stick = m_stickToBottom;
+    m_rows.append(rows);
+    updateScrollBars();
+    if(stick)
+        scrollToBottom();
+    viewport()->update();
+}
+
+void LogLinesDisplayWidget::prependRows(const QVector<qint64> &rows)
+{
+    if(rows.isEmpty()) return;
+    bool stick = m_stickToBottom;
+    int value = verticalScrollBar()->value();
+    int added = rows.size();
+    // строки пишутся в свободное место в начале списка; когда его не хватает,
+    // запас делается не меньше самого списка, чтобы догрузка не сдвигала список каждый раз
+    if(m_rowsBegin < added)
+    {
+        int count = rowCount();
+        int reserve = qMax(added, count);
+        QVector<qint64> moved(reserve + count);
+        std::copy(m_rows.constBegin() + m_rowsBegin, m_rows.constEnd(), moved.begin() + reserve);
+        m_rows.swap(moved);
+        m_rowsBegin = reserve;
+    }
+    m_rowsBegin -= added;
+    std::copy(rows.constBegin(), rows.constEnd(), m_rows.begin() + m_rowsBegin);
+
+    // выделение остается на тех же строках
+    for(TextPosition* position : {&m_selectionAnchor, &m_selectionCursor})
+        if(position->row >= 0)
+            position->row += added;
+
+    m_visibleRows.clear();
+    updateScrollBars();
+    if(stick)
+        scrollToBottom();
+    else
+        verticalScrollBar()->setValue(value + added);
+    viewport()->update();
+}
+
+void LogLinesDisplayWidget::removeRowsBefore(qint64 index)
+{
+    // список отсортирован: вытесненные строки всегда в его начале
+    auto begin = m_rows.constBegin() + m_rowsBegin;
+    int removed = int(std::lower_bound(begin, m_rows.constEnd(), index) - begin);
+    if(!removed) return;
+
+    bool stick = m_stickToBottom;
+    int value = verticalScrollBar()->value();
+    // начало списка сдвигается без перемещения элементов,
+    // а память освобождается одним сдвигом, когда убрано больше половины
+    m_rowsBegin += removed;
+    if(m_rowsBegin > m_rows.size() / 2)
+    {
+        m_rows.remove(0, m_rowsBegin);
+        m_rowsBegin = 0;
+    }
+
+    // выделение остается на тех же строках, вытесненная часть отбрасывается
+    for(TextPosition* position : {&m_selectionAnchor, &m_selectionCursor})
+    {
+        if(position->row < 0) continue;
+        position->row -= removed;
+        if(position->row < 0){
+            position->row = 0;
+            position->column = 0;
+        }
+    }
+
+    // раскладки закешированы по номеру в истории и остаются верными
+    m_visibleRows.clear();
+    updateScrollBars();
+    if(stick)
+        scrollToBottom();
+    else
+        verticalScrollBar()->setValue(qMax(0, value - removed));
+    viewport()->update();
+}
+
+void LogLinesDisplayWidget::clear()
+{
+    setRows(QVector<qint64>());
+}
+
+void LogLinesDisplayWidget::setLineWrap(bool wrap)
+{
+    if(m_lineWrap == wrap) return;
+    bool stick = m_stickToBottom;
+    m_lineWrap = wrap;
+    setHorizontalScrollBarPolicy(wrap ? Qt::ScrollBarAlwaysOff : Qt::ScrollBarAsNeeded);
+    invalidateLayouts();
+    updateScrollBars();
+    if(stick)
+        scrollToBottom();
+    viewport()->update();
+}
+
+void LogLinesDisplayWidget::setTextFont(const QFont &font)
+{
+    bool stick = m_stickToBottom;
+    m_font = font;
+    m_lineHeight = qMax(1, QFontMetrics(m_font).lineSpacing());
+    m_maxLineWidth = 0;
+    invalidateLayouts();
+    updateScrollBars();
+    if(stick)
+        scrollToBottom();
+    viewport()->update();
+}
+
+void LogLinesDisplayWidget::scrollToBottom()
+{
+    verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+    m_stickToBottom = true;
+}
+
+void LogLinesDisplayWidget::scrollToRow(int row)
+{
+    if(row < 0 || row >= rowCount()) return;
+    int first = verticalScrollBar()->value();
+    int visible = qMax(1, viewport()->height() / m_lineHeight);
+    if(row < first || row >= first + visible - 1)
+        verticalScrollBar()->setValue(row - visible / 2);
+}
+
+int LogLinesDisplayWidget::rowOf(qint64 index) const
+{
+    auto begin = m_rows.constBegin() + m_rowsBegin;
+    auto it = std::lower_bound(begin, m_rows.constEnd(), index);
+    if(it == m_rows.constEnd() || *it != index) return -1;
+    return int(it - begin);
+}
+
+int LogLinesDisplayWidget::rowAtOrAfter(qint64 index) const
+{
+    auto begin = m_rows.constBegin() + m_rowsBegin;
+    return int(std::lower_bound(begin, m_rows.constEnd(), index) - begin);
+}
+
+void LogLinesDisplayWidget::setHighlight(const QString &text, Qt::CaseSensitivity cs)
+{
+    if(m_highlight == text && m_highlightCase == cs) return;
+    m_highlight = text;
+    m_highlightCase = cs;
+    invalidateLayouts();
+    viewport()->update();
+}
+
+void LogLinesDisplayWidget::setCurrentMatch(qint64 index)
+{
+    if(m_currentMatch == index) return;
+    // перераскладываются только две строки: прежнее и новое совпадение
+    m_layouts.remove(m_currentMatch);
+    m_layouts.remove(index);
+    m_visibleRows.clear();
+    m_currentMatch = index;
+    viewport()->update();
+}
+
+QString LogLinesDisplayWidget::selectedText() const
+{
+    const QList<FormattedPart> parts = formatSelection(false);
+    QString text;
+    for(int i = 0; i < parts.size(); i++)
+    {
+        if(i) text += '\n';
+        text += parts.at(i).text;
+    }
+    return text;
+}
+
+bool LogLinesDisplayWidget::hasSelection() const
+{
+    return m_selectionAnchor.row >= 0 && !(m_selectionAnchor == m_selectionCursor);
+}
+
+void LogLinesDisplayWidget::selectAll()
+{
+    if(!rowCount()) return;
+    m_selectionAnchor.row = 0;
+    m_selectionAnchor.column = 0;
+    m_selectionCursor.row = rowCount() - 1;
+    m_selectionCursor.column = rowText(rowCount() - 1, nullptr).size();
+    viewport()->update();
+}
+
+void LogLinesDisplayWidget::copy()
+{
+    if(!hasSelection()) return;
+    TextPosition start, end;
+    selectionBounds(start, end);
+    // HTML в разы больше текста, поэтому для больших выделений не строится
+    bool richText = end.row - start.row < rich_copy_rows;
+    const QList<FormattedPart> parts = formatSelection(richText);
+
+    // GUI поток только склеивает готовые части по порядку
+    QString text;
+    QTextDocument doc;
+    QTextCursor cursor(&doc);
+    for(int i = 0; i < parts.size(); i++)
+    {
+        if(i){
+            text += '\n';
+            if(richText) cursor.insertBlock();
+        }
+        text += parts.at(i).text;
+        if(richText) cursor.insertFragment(parts.at(i).fragment);
+    }
+    QMimeData* mime = new QMimeData();
+    mime->setText(text);
+    if(richText)
+        mime->setHtml(doc.toHtml());
+    QApplication::clipboard()->setMimeData(mime);
+}
+
+void LogLinesDisplayWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(viewport());
+    layoutVisibleRows();
+
+    TextPosition start, end;
+    selectionBounds(start, end);
+    bool selection = !(start == end);
+    QTextCharFormat selectionFormat;
+    selectionFormat.setBackground(palette().highlight());
+    selectionFormat.setForeground(palette().highlightedText());
+
+    qreal x = text_margin - horizontalScrollBar()->value();
+    for(const VisibleRow& visible : std::as_const(m_visibleRows))
+    {
+        QVector<QTextLayout::FormatRange> selections;
+        if(selection && visible.row >= start.row && visible.row <= end.row)
+        {
+            QTextLayout::FormatRange range;
+            range.start = (visible.row == start.row) ? start.column : 0;
+            int to = (visible.row == end.row) ? end.column : visible.layout->text().size();
+            range.length = to - range.start;
+            range.format = selectionFormat;
+            if(range.length > 0)
+                selections.append(range);
+        }
+        visible.layout->draw(&painter, QPointF(x, visible.top), selections);
+    }
+}
+
+void LogLinesDisplayWidget::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    bool stick = m_stickToBottom;
+    // при переносе строк высота строк зависит от ширины окна
+    if(m_lineWrap && event->oldSize().width() != event->size().width())
+        invalidateLayouts();
+    updateScrollBars();
+    if(stick)
+        scrollToBottom();
+}
+
+void LogLinesDisplayWidget::scrollContentsBy(int dx, int dy)
+{
+    // прокрутка идет по строкам, поэтому окно просто перерисовывается
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+    viewport()->update();
+}
+
+void LogLinesDisplayWidget::keyPressEvent(QKeyEvent *event)
+{
+    if(event->matches(QKeySequence::Copy)){
+        copy();
+        return;
+    }
+    if(event->matches(QKeySequence::SelectAll)){
+        selectAll();
+        return;
+    }
+    if(event->matches(QKeySequence::MoveToStartOfDocument)){
+        verticalScrollBar()->setValue(0);
+        return;
+    }
+    if(event->matches(QKeySequence::MoveToEndOfDocument)){
+        scrollToBottom();
+        return;
+    }
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void LogLinesDisplayWidget::mousePressEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::LeftButton)
+    {
+        TextPosition position = positionAt(event->pos());
+        if(!(event->modifiers() & Qt::ShiftModifier) || m_selectionAnchor.row < 0)
+            m_selectionAnchor = position;
+        m_selectionCursor = position;
+        m_selecting = true;
+        viewport()->update();
+    }
+    QAbstractScrollArea::mousePressEvent(event);
+}
+
+void LogLinesDisplayWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if(m_selecting)
+    {
+        // выделение за пределами окна прокручивает его
+        if(event->pos().y() < 0)
+            verticalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepSub);
+        else if(event->pos().y() > viewport()->height())
+            verticalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepAdd);
+        m_selectionCursor = positionAt(event->pos());
+        viewport()->update();
+    }
+    QAbstractScrollArea::mouseMoveEvent(event);
+}
+
+void LogLinesDisplayWidget::mouseReleaseEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::LeftButton)
+        m_selecting = false;
+    QAbstractScrollArea::mouseReleaseEvent(event);
+}
+
+void LogLinesDisplayWidget::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    // двойной клик выделяет строку целиком
+    TextPosition position = positionAt(event->pos());
+    if(position.row >= 0)
+    {
+        m_selectionAnchor.row = m_selectionCursor.row = position.row;
+        m_selectionAnchor.column = 0;
+        m_selectionCursor.column = rowText(position.row, nullptr).size();
+        viewport()->update();
+    }
+    QAbstractScrollArea::mouseDoubleClickEvent(event);
+}
+
+void LogLinesDisplayWidget::contextMenuEvent(QContextMenuEvent *event)
+{
+    QMenu menu(this);
+    QAction* copyAction = menu.addAction("Копировать", this, &LogLinesDisplayWidget::copy);
+    copyAction->setShortcut(QKeySequence::Copy);
+    copyAction->setEnabled(hasSelection());
+    QAction* selectAllAction = menu.addAction("Выделить все", this, &LogLinesDisplayWidget::selectAll);
+    selectAllAction->setShortcut(QKeySequence::SelectAll);
+    menu.exec(event->globalPos());
+}
+
+QString LogLinesDisplayWidget::rowText(int row, QVector<QTextLayout::FormatRange> *formats, int *messageStart) const
+{
+    if(!m_history || !m_formatter) return QString();
+    return m_formatter->formatLine(m_history->line(historyIndex(row)), formats, messageStart);
+}
+
+QList<LogLinesDisplayWidget::FormattedPart> LogLinesDisplayWidget::formatSelection(bool richText) const
+{
+    TextPosition start, end;
+    selectionBounds(start, end);
+    if(start == end || !m_history || !m_formatter) return QList<FormattedPart>();
+    end.row = qMin(end.row, rowCount() - 1);
+
+    QVector<SelectionPart> parts;
+    for(int first = start.row; first <= end.row; first += copy_block_rows)
+    {
+        int last = qMin(first + copy_block_rows - 1, end.row);
+        parts.append({first, last, first == start.row ? start.column : 0, last == end.row ? end.column : -1});
+    }
+
+    // история меняется только в GUI потоке, который ждет завершения задач
+    std::function<FormattedPart(const SelectionPart&)> formatPart = [this, richText](const SelectionPart& part)
+    {
+        FormattedPart result;
+        ConsoleFormatter formatter(*m_formatter); // форматер меняет свое состояние - у задачи своя копия
+        if(!richText)
+        {
+            for(int row = part.firstRow; row <= part.lastRow; row++)
+            {
+                QString line = formatter.formatLine(m_history->line(historyIndex(row)), nullptr);
+                int from = (row == part.firstRow) ? part.startColumn : 0;
+                int to = (row == part.lastRow && part.endColumn >= 0) ? part.endColumn : line.size();
+                result.text += line.mid(from, to - from);
+                if(row != part.lastRow)
+                    result.text += '\n';
+            }
+            return result;
+        }
+
+        QVector<LogLine> lines;
+        lines.reserve(part.lastRow - part.firstRow + 1);
+        for(int row = part.firstRow; row <= part.lastRow; row++)
+            lines.append(m_history->line(historyIndex(row)));
+        QScopedPointer<QTextDocument> doc(formatter.formatBlockToDoc(lines));
+        // formatBlockToDoc вставляет блок перед каждой строкой, первый блок документа пустой
+        if(doc->blockCount() < 2) return result;
+        QTextBlock first = doc->firstBlock().next();
+        QTextBlock last = doc->lastBlock();
+        QTextCursor cursor(doc.data());
+        cursor.setPosition(first.position() + qMin(part.startColumn, first.length() - 1));
+        if(part.endColumn >= 0)
+            cursor.setPosition(last.position() + qMin(part.endColumn, last.length() - 1), QTextCursor::KeepAnchor);
+        else
+            cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+        result.fragment = cursor.selection();
+        result.text = result.fragment.toPlainText();
+        return result;
+    };
+    QThreadPool* pool = m_threadPool ? m_threadPool : QThreadPool::globalInstance();
+    QFuture<FormattedPart> future = Concurrent::mapped(pool, parts, formatPart);
+    future.waitForFinished();
+    return future.results();
+}
+
+QSharedPointer<QTextLayout> LogLinesDisplayWidget::layoutForRow(int row)
+{
+    qint64 index = historyIndex(row);
+    auto it = m_layouts.constFind(index);
+    if(it != m_layouts.constEnd())
+        return it.value();
+
+    QVector<QTextLayout::FormatRange> formats;
+    int messageStart = 0;
+    QString text = rowText(row, &formats, &messageStart);
+    if(!m_highlight.isEmpty())
+    {
+        // LogSearch ищет только в тексте сообщения - подсвечивается только он, без полей строки
+        QTextCharFormat match;
+        match.setBackground(index == m_currentMatch ? QColor(0xff, 0x8c, 0x00) : QColor(0xff, 0xd7, 0x00));
+        match.setForeground(Qt::black);
+        for(int from = text.indexOf(m_highlight, messageStart, m_highlightCase); from >= 0;
+            from = text.indexOf(m_highlight, from + m_highlight.size(), m_highlightCase))
+        {
+            QTextLayout::FormatRange range;
+            range.start = from;
+            range.length = m_highlight.size();
+            range.format = match;
+            formats.append(range);
+        }
+    }
+    QSharedPointer<QTextLayout> layout(new QTextLayout(text, m_font));
+    QTextOption option;
+    option.setWrapMode(m_lineWrap ? QTextOption::WrapAtWordBoundaryOrAnywhere : QTextOption::NoWrap);
+    layout->setTextOption(option);
+    layout->setFormats(formats);
+    layout->setCacheEnabled(true);
+
+    qreal width = qMax(1, viewport()->width() - 2 * text_margin);
+    qreal height = 0;
+    layout->beginLayout();
+    for(;;)
+    {
+        QTextLine line = layout->createLine();
+        if(!line.isValid()) break;
+        line.setLineWidth(width);
+        line.setPosition(QPointF(0, height));
+        height += line.height();
+    }
+    layout->endLayout();
+
+    m_layouts.insert(index, layout);
+    return layout;
+}
+
+int LogLinesDisplayWidget::rowHeight(int row)
+{
+    return qMax(m_lineHeight, qCeil(layoutForRow(row)->boundingRect().height()));
+}
+
+void LogLinesDisplayWidget::layoutVisibleRows()
+{
+    m_visibleRows.clear();
+    QHash<qint64, QSharedPointer<QTextLayout>> used;
+    int height = viewport()->height();
+    int maxWidth = m_maxLineWidth;
+    int top = 0;
+    for(int row = verticalScrollBar()->value(); row < rowCount() && top < height; row++)
+    {
+        QSharedPointer<QTextLayout> layout = layoutForRow(row);
+        int rowHeight = qMax(m_lineHeight, qCeil(layout->boundingRect().height()));
+        m_visibleRows.append({row, top, rowHeight, layout});
+        used.insert(historyIndex(row), layout);
+        maxWidth = qMax(maxWidth, qCeil(layout->maximumWidth()));
+        top += rowHeight;
+    }
+    // в кеше остаются только видимые строки
+    m_layouts.swap(used);
+
+    if(!m_lineWrap && maxWidth != m_maxLineWidth)
+    {
+        m_maxLineWidth = maxWidth;
+        horizontalScrollBar()->setRange(0, qMax(0, m_maxLineWidth + 2 * text_margin - viewport()->width()));
+    }
+}
+
+int LogLinesDisplayWidget::bottomFirstRow()
+{
+    int height = viewport()->height();
+    if(!m_lineWrap)
+        return qMax(0, rowCount() - qMax(1, height / m_lineHeight));
+
+    // с переносом высота строк разная: набираем строки с конца, пока они помещаются в окно
+    int row = rowCount();
+    int used = 0;
+    while(row > 0)
+    {
+        int h = rowHeight(row - 1);
+        if(used + h > height) break;
+        used += h;
+        row--;
+    }
+    return qMax(0, qMin(row, rowCount() - 1));
+}
+
+void LogLinesDisplayWidget::updateScrollBars()
+{
+    QScrollBar* vertical = verticalScrollBar();
+    vertical->setPageStep(qMax(1, viewport()->height() / m_lineHeight));
+    vertical->setRange(0, bottomFirstRow());
+
+    if(m_lineWrap)
+        horizontalScrollBar()->setRange(0, 0);
+    else
+    {
+        horizontalScrollBar()->setPageStep(viewport()->width());
+        horizontalScrollBar()->setSingleStep(QFontMetrics(m_font).averageCharWidth() * 4);
+        horizontalScrollBar()->setRange(0, qMax(0, m_maxLineWidth + 2 * text_margin - viewport()->width()));
+    }
+}
+
+void LogLinesDisplayWidget::invalidateLayouts()
+{
+    m_layouts.clear();
+    m_visibleRows.clear();
+}
+
+LogLinesDisplayWidget::TextPosition LogLinesDisplayWidget::positionAt(const QPoint &pos) const
+{
+    TextPosition position;
+    if(m_visibleRows.isEmpty()) return position;
+
+    // выше первой строки - начало первой, ниже последней - конец последней
+    const VisibleRow& first = m_visibleRows.first();
+    const VisibleRow& last = m_visibleRows.last();
+    if(pos.y() < first.top){
+        position.row = first.row;
+        return position;
+    }
+    if(pos.y() >= last.top + last.height){
+        position.row = last.row;
+        position.column = last.layout->text().size();
+        return position;
+    }
+
+    qreal x = pos.x() - text_margin + horizontalScrollBar()->value();
+    for(const VisibleRow& visible : m_visibleRows)
+    {
+        if(pos.y() >= visible.top + visible.height) continue;
+        position.row = visible.row;
+        QTextLayout* layout = visible.layout.data();
+        qreal y = pos.y() - visible.top;
+        for(int i = 0; i < layout->lineCount(); i++)
+        {
+            QTextLine line = layout->lineAt(i);
+            if(y < line.y() + line.height() || i == layout->lineCount() - 1){
+                position.column = line.xToCursor(x);
+                break;
+            }
+        }
+        break;
+    }
+    return position;
+}
+
+void LogLinesDisplayWidget::selectionBounds(TextPosition &start, TextPosition &end) const
+{
+    start = m_selectionAnchor;
+    end = m_selectionCursor;
+    if(start.row < 0 || end.row < 0){
+        start = end = TextPosition();
+        return;
+    }
+    if(end < start)
+        std::swap(start, end);
+}
@@ -0,0 +1,209 @@
+#ifndef LOGLINESDISPLAYWIDGET_H
+#define LOGLINESDISPLAYWIDGET_H
+
+#include "qabstractscrollarea.h"
+#include "qsharedpointer.h"
+#include "qtextdocumentfragment.h"
+#include "qtextlayout.h"
+#include <QWidget>
+
+class QThreadPool;
+
+namespace Logging
+{
+
+class ConsoleFormatter;
+class LogHistory;
+
+/*!
+ * \brief The LogLinesDisplayWidget class виртуализированное отображение истории консоли.
+ *  Виджет не хранит текст: у него есть только список отображаемых строк (номера строк LogHistory),
+ *  а форматируются и раскладываются (QTextLayout) лишь строки, попавшие в окно.
+ *  Поэтому отрисовка, прокрутка и добавление строк не зависят от размера истории.
+ *  Вертикальная прокрутка идет по строкам логов: значение полосы - первая видимая строка.
+ *  Нельзя вызывать из других потоков!
+ */
+class LogLinesDisplayWidget : public QAbstractScrollArea
+{
+    Q_OBJECT
+public:
+    explicit LogLinesDisplayWidget(QWidget *parent = nullptr);
+    ~LogLinesDisplayWidget();
+
+    /*!
+     * \brief setSource задает историю и форматер, из которых рисуются строки
+     */
+    void setSource(const LogHistory* history, ConsoleFormatter* formatter);
+    /*!
+     * \brief setThreadPool пул, в котором форматируется копируемое выделение
+     *  (nullptr - глобальный пул приложения)
+     */
+    void setThreadPool(QThreadPool* pool) { m_threadPool = pool; }
+
+    /*!
+     * \brief setRows заменяет список отображаемых строк (номера строк LogHistory по возрастанию)
+     */
+    void setRows(const QVector<qint64>& rows);
+    /*!
+     * \brief appendRows добавляет строки в конец. Если окно было прокручено до конца,
+     *  оно остается внизу (эффект прилипания)
+     */
+    void appendRows(const QVector<qint64>& rows);
+    /*!
+     * \brief prependRows добавляет строки в начало (догрузка старой истории). Окно остается
+     *  на тех же строках логов, прокрученное до конца - внизу
+     */
+    void prependRows(const QVector<qint64>& rows);
+    /*!
+     * \brief removeRowsBefore убирает строки с номерами меньше index (вытесненные из LogHistory).
+     *  Прокрутка и выделение остаются на тех же строках логов
+     */
+    void removeRowsBefore(qint64 index);
+    void clear();
+    int rowCount() const { return m_rows.size() - m_rowsBegin; }
+
+    void setLineWrap(bool wrap);
+    bool lineWrap() const { return m_lineWrap; }
+    void setTextFont(const QFont& font);
+
+    bool isAtBottom() const { return m_stickToBottom; }
+    void scrollToBottom();
+    /*!
+     * \brief scrollToRow прокручивает так, чтобы строка row (номер в списке отображаемых) была видна
+     */
+    void scrollToRow(int row);
+    /*!
+     * \brief rowOf номер в списке отображаемых для строки index LogHistory, -1 - строка не отображается
+     */
+    int rowOf(qint64 index) const;
+    /*!
+     * \brief rowAtOrAfter номер в списке отображаемых первой строки с индексом LogHistory не меньше index,
+     *  rowCount() - таких нет
+     */
+    int rowAtOrAfter(qint64 index) const;
+
+    /*!
+     * \brief setHighlight подсвечивает вхождения text во всех строках, пустой text - без подсветки
+     */
+    void setHighlight(const QString& text, Qt::CaseSensitivity cs);
+    /*!
+     * \brief setCurrentMatch выделяет другим цветом строку index LogHistory (текущее совпадение поиска)
+     */
+    void setCurrentMatch(qint64 index);
+
+    QString selectedText() const;
+    bool hasSelection() const;
+    void selectAll();
+    /*!
+     * \brief copy копирует выделение в буфер обмена: текст и, для не слишком больших выделений,
+     *  HTML с цветами консоли
+     */
+    void copy();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void keyPressEvent(QKeyEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+    void contextMenuEvent(QContextMenuEvent* event) override;
+
+private:
+    /*!
+     * \brief The TextPosition struct позиция в тексте: строка списка и символ в ней
+     */
+    struct TextPosition
+    {
+        int row = -1;
+        int column = 0;
+        bool operator<(const TextPosition& other) const {
+            return row < other.row || (row == other.row && column < other.column);
+        }
+        bool operator==(const TextPosition& other) const {
+            return row == other.row && column == other.column;
+        }
+    };
+    /*!
+     * \brief The VisibleRow struct строка, разложенная при последней отрисовке
+     */
+    struct VisibleRow
+    {
+        int row;
+        int top;
+        int height;
+        QSharedPointer<QTextLayout> layout;
+    };
+
+    inline qint64 historyIndex(int row) const { return m_rows.at(m_rowsBegin + row); }
+    /*!
+     * \brief The SelectionPart struct часть выделения, форматируемая одной задачей
+     */
+    struct SelectionPart
+    {
+        int firstRow;
+        int lastRow;
+        int startColumn; // начало в первой строке
+        int endColumn;   // конец в последней строке, -1 - до конца строки
+    };
+    /*!
+     * \brief The FormattedPart struct результат форматирования части выделения
+     */
+    struct FormattedPart
+    {
+        QString text;
+        QTextDocumentFragment fragment; // только при richText
+    };
+
+    QString rowText(int row, QVector<QTextLayout::FormatRange>* formats, int* messageStart = nullptr) const;
+    /*!
+     * \brief formatSelection форматирует выделение частями параллельно в пуле setThreadPool(..)
+     *  (у каждой задачи своя копия ConsoleFormatter), richText - строить фрагменты документа через formatBlockToDoc.
+     *  Части возвращаются по порядку, склеивает их вызывающий.
+     */
+    QList<FormattedPart> formatSelection(bool richText) const;
+    QSharedPointer<QTextLayout> layoutForRow(int row);
+    int rowHeight(int row);
+    /*!
+     * \brief layoutVisibleRows раскладывает строки, попадающие в окно, начиная с первой видимой
+     */
+    void layoutVisibleRows();
+    /*!
+     * \brief bottomFirstRow первая видимая строка, когда окно прокручено до конца
+     */
+    int bottomFirstRow();
+    void updateScrollBars();
+    void invalidateLayouts();
+    TextPosition positionAt(const QPoint& pos) const;
+    void selectionBounds(TextPosition& start, TextPosition& end) const;
+
+    const LogHistory* m_history = nullptr;
+    ConsoleFormatter* m_formatter = nullptr;
+    QThreadPool* m_threadPool = nullptr;
+    QVector<qint64> m_rows;  // номера отображаемых строк LogHistory, список начинается с m_rowsBegin
+    int m_rowsBegin = 0;     // свободное место в начале списка: вытесненные строки (removeRowsBefore)
+                             // или запас для prependRows
+    QHash<qint64, QSharedPointer<QTextLayout>> m_layouts; // кеш раскладки строк по номеру в LogHistory
+    QVector<VisibleRow> m_visibleRows;
+
+    QFont m_font;
+    int m_lineHeight = 1;
+    int m_maxLineWidth = 0;  // ширина самой длинной из уже разложенных строк (без переноса)
+    bool m_lineWrap = false;
+    bool m_stickToBottom = true;
+
+    QString m_highlight;
+    Qt::CaseSensitivity m_highlightCase = Qt::CaseInsensitive;
+    qint64 m_currentMatch = -1;
+
+    TextPosition m_selectionAnchor;
+    TextPosition m_selectionCursor;
+    bool m_selecting = false;
+};
+
+} //namespace Logging
+
+
+#endif // LOGLINESDISPLAYWIDGET_H
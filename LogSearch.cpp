@@ -0,0 +1,272 @@
+#include "LogSearch.h"
+#include "LogConsoleWidget.h"
+#include "LogHistory.h"
+#include "LoggingConcurrent.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOGSEARCH_SSE2
+#endif
+
+using namespace Logging;
+
+const int search_chunk_size = 65536;  // строк истории в одной задаче поиска
+const int search_cancel_check = 4096; // как часто задача поиска проверяет отмену
+
+namespace {
+
+inline char asciiLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : c;
+}
+
+inline bool equalsLower(const char* data, const char* pattern, int size)
+{
+    for(int i = 0; i < size; i++)
+        if(asciiLower(data[i]) != pattern[i]) return false;
+    return true;
+}
+
+#ifdef LOGSEARCH_SSE2
+// 'A'..'Z' -> 'a'..'z' для 16 байт: сдвиг диапазона к -128 и одно знаковое сравнение
+inline __m128i lower16(__m128i v)
+{
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(char(128 - 'A')));
+    __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(char(-128 + 26)));
+    return _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+} //namespace
+
+
+LogSearch::LogSearch(const LogHistory *history, QReadWriteLock *lock, QThreadPool *pool, QObject *parent) :
+    QObject(parent), m_history(history), m_lock(lock), m_pool(pool)
+{
+    m_watcher = new QFutureWatcher<RangeMatches>(this);
+    connect(m_watcher, &QFutureWatcher<RangeMatches>::resultReadyAt, this, &LogSearch::takeResult);
+    connect(m_watcher, &QFutureWatcher<RangeMatches>::finished, this, &LogSearch::finished);
+}
+
+LogSearch::~LogSearch()
+{
+    // задачи читают историю - дожидаемся их до разрушения владельца истории
+    m_generation++;
+    m_watcher->cancel();
+    m_watcher->waitForFinished();
+}
+
+void LogSearch::start(const QString &text, Qt::CaseSensitivity cs, QSharedPointer<ConsoleFormatter> filter)
+{
+    cancel();
+    if(text.isEmpty()) return;
+
+    m_query.text = text;
+    m_query.caseInsensitive = cs == Qt::CaseInsensitive;
+    m_query.filter = filter;
+    bool ascii = true;
+    for(QChar c : text)
+        if(c.unicode() >= 0x80){
+            ascii = false;
+            break;
+        }
+    m_query.unicodeFold = m_query.caseInsensitive && !ascii;
+    m_query.pattern = m_query.caseInsensitive && ascii ? text.toLower().toUtf8() : text.toUtf8();
+
+    int generation = m_generation;
+    m_scannedBegin = m_history->firstIndex();
+    m_scannedEnd = m_history->endIndex();
+    qint64 begin = m_scannedBegin, end = m_scannedEnd;
+    if(filter && filter->timeWindow(m_query.timeFrom, m_query.timeTo))
+        m_history->timeRange(m_query.timeFrom, m_query.timeTo, begin, end);
+    QVector<QPair<qint64, qint64>> ranges;
+    for(qint64 from = begin; from < end; from += search_chunk_size)
+        ranges.append({from, qMin(from + search_chunk_size, end)});
+
+    Query query = m_query;
+    std::function<RangeMatches(const QPair<qint64, qint64>&)> scan =
+        [this, query, generation](const QPair<qint64, qint64>& range)
+    {
+        return RangeMatches(range.first, scanRange(query, range.first, range.second, generation));
+    };
+    m_watcher->setFuture(Concurrent::mapped(m_pool, ranges, scan));
+    emit matchesChanged();
+}
+
+void LogSearch::cancel()
+{
+    m_generation++;
+    m_watcher->cancel();
+    m_query = Query();
+    m_matches.clear();
+    m_matchCount = 0;
+}
+
+void LogSearch::scanAppended()
+{
+    if(!isActive()) return;
+    qint64 from = qMax(m_scannedEnd, m_history->firstIndex());
+    m_scannedEnd = m_history->endIndex();
+    if(from >= m_scannedEnd) return;
+    // история пишется только в этом потоке, поэтому без блокировки
+    QVector<qint64> found = scanRange(m_query, from, m_scannedEnd, m_generation);
+    if(found.isEmpty()) return;
+    m_matchCount += found.size();
+    m_matches.insert(from, found);
+    emit matchesChanged();
+}
+
+void LogSearch::scanPrepended()
+{
+    if(!isActive()) return;
+    qint64 from = m_history->firstIndex();
+    qint64 to = m_scannedBegin;
+    m_scannedBegin = qMin(from, m_scannedBegin);
+    if(from >= to) return;
+    QVector<qint64> found = scanRange(m_query, from, to, m_generation);
+    if(found.isEmpty()) return;
+    m_matchCount += found.size();
+    m_matches.insert(from, found);
+    emit matchesChanged();
+}
+
+void LogSearch::discardBefore(qint64 index)
+{
+    bool changed = false;
+    auto it = m_matches.begin();
+    while(it != m_matches.end() && !it.value().isEmpty() && it.value().first() < index)
+    {
+        QVector<qint64>& found = it.value();
+        int removed = int(std::lower_bound(found.begin(), found.end(), index) - found.begin());
+        m_matchCount -= removed;
+        changed = true;
+        if(removed == found.size()){
+            it = m_matches.erase(it);
+            continue;
+        }
+        found.remove(0, removed);
+        break;
+    }
+    if(changed)
+        emit matchesChanged();
+}
+
+qint64 LogSearch::nextMatch(qint64 after) const
+{
+    // диапазон, который может содержать after, и все следующие
+    auto it = m_matches.upperBound(after);
+    if(it != m_matches.constBegin())
+        --it;
+    for(; it != m_matches.constEnd(); ++it)
+    {
+        const QVector<qint64>& found = it.value();
+        auto pos = std::upper_bound(found.constBegin(), found.constEnd(), after);
+        if(pos != found.constEnd())
+            return *pos;
+    }
+    return -1;
+}
+
+qint64 LogSearch::previousMatch(qint64 before) const
+{
+    auto it = m_matches.lowerBound(before);
+    while(it != m_matches.constBegin())
+    {
+        --it;
+        const QVector<qint64>& found = it.value();
+        auto pos = std::lower_bound(found.constBegin(), found.constEnd(), before);
+        if(pos != found.constBegin())
+            return *(pos - 1);
+    }
+    return -1;
+}
+
+int LogSearch::indexOf(const char *data, int size, const QByteArray &pattern, bool caseInsensitive)
+{
+    const int length = pattern.size();
+    const char* p = pattern.constData();
+    if(!length) return 0;
+    if(size < length) return -1;
+    if(length == 1 && !caseInsensitive){
+        const void* found = memchr(data, p[0], size);
+        return found ? int(static_cast<const char*>(found) - data) : -1;
+    }
+
+    int i = 0;
+#ifdef LOGSEARCH_SSE2
+    // кандидаты - позиции, где совпали первый и последний байт образца
+    const __m128i first = _mm_set1_epi8(p[0]);
+    const __m128i last = _mm_set1_epi8(p[length - 1]);
+    for(; i + length - 1 + 16 <= size; i += 16)
+    {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + length - 1));
+        if(caseInsensitive){
+            blockFirst = lower16(blockFirst);
+            blockLast = lower16(blockLast);
+        }
+        quint32 mask = quint32(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst),
+                                                               _mm_cmpeq_epi8(last, blockLast))));
+        while(mask)
+        {
+            int candidate = i + qCountTrailingZeroBits(mask);
+            if(caseInsensitive ? equalsLower(data + candidate + 1, p + 1, length - 2)
+                               : !memcmp(data + candidate + 1, p + 1, length - 2))
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    // хвост (или вся строка без SSE2)
+    for(; i + length <= size; i++)
+    {
+        if(caseInsensitive ? equalsLower(data + i, p, length) : !memcmp(data + i, p, length))
+            return i;
+    }
+    return -1;
+}
+
+QVector<qint64> LogSearch::scanRange(const Query &query, qint64 from, qint64 to, int generation) const
+{
+    QVector<qint64> found;
+    QVector<qint64> visible;
+    QReadLocker locker(m_lock);
+    // за время ожидания начало диапазона могло быть вытеснено
+    from = qMax(from, m_history->firstIndex());
+    to = qMin(to, m_history->endIndex());
+    for(qint64 block = from; block < to; block += search_cancel_check)
+    {
+        if(m_generation.load(std::memory_order_relaxed) != generation)
+            return QVector<qint64>();
+        qint64 end = qMin(block + search_cancel_check, to);
+        // сначала фильтры по колонкам истории, текст - только у прошедших их строк
+        visible.clear();
+        if(query.filter)
+            query.filter->appendVisibleRows(*m_history, block, end, query.timeFrom, query.timeTo, visible);
+        else
+            for(qint64 i = block; i < end; i++)
+                visible.append(i);
+        for(qint64 i : std::as_const(visible))
+        {
+            bool match;
+            if(query.unicodeFold)
+                match = m_history->message(i).contains(query.text, Qt::CaseInsensitive);
+            else
+                match = indexOf(m_history->messageUtf8(i), m_history->messageSize(i), query.pattern, query.caseInsensitive) >= 0;
+            if(match)
+                found.append(i);
+        }
+    }
+    return found;
+}
+
+void LogSearch::takeResult(int index)
+{
+    const RangeMatches result = m_watcher->resultAt(index);
+    if(result.second.isEmpty()) return;
+    m_matchCount += result.second.size();
+    m_matches.insert(result.first, result.second);
+    emit matchesChanged();
+}
@@ -0,0 +1,120 @@
+#ifndef LOGSEARCH_H
+#define LOGSEARCH_H
+
+#include "qfuturewatcher.h"
+#include "qmap.h"
+#include "qreadwritelock.h"
+#include "qsharedpointer.h"
+#include <QObject>
+#include <atomic>
+
+class QThreadPool;
+
+
+namespace Logging {
+
+class ConsoleFormatter;
+class LogHistory;
+
+/*!
+ * \brief The LogSearch class полнотекстовый поиск по сообщениям LogHistory.
+ *  История делится на диапазоны, которые просматриваются параллельно. Текст ищется
+ *  прямо в UTF-8 блоках истории, без построения QString: SSE2 сравнивает первый и последний
+ *  байт образца сразу с 16 позициями, полностью проверяются только кандидаты.
+ *  Результаты приходят по мере готовности диапазонов (matchesChanged), новый запрос
+ *  отменяет предыдущий. Методы вызываются из GUI потока: история меняется только в нем,
+ *  под записью lock, а задачи поиска читают ее под чтением.
+ */
+class LogSearch : public QObject
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief LogSearch поиск по history, задачи поиска выполняются в pool
+     */
+    LogSearch(const LogHistory* history, QReadWriteLock* lock, QThreadPool* pool, QObject* parent = nullptr);
+    ~LogSearch();
+
+    /*!
+     * \brief start ищет text среди строк, проходящих фильтры filter (копия настроек консоли).
+     *  Пустой text сбрасывает поиск.
+     */
+    void start(const QString& text, Qt::CaseSensitivity cs, QSharedPointer<ConsoleFormatter> filter);
+    /*!
+     * \brief cancel прерывает поиск и сбрасывает результаты
+     */
+    void cancel();
+    /*!
+     * \brief scanAppended проверяет строки, добавленные в историю после запуска поиска (синхронно)
+     */
+    void scanAppended();
+    /*!
+     * \brief scanPrepended проверяет строки, добавленные в начало истории после запуска поиска (синхронно)
+     */
+    void scanPrepended();
+    /*!
+     * \brief discardBefore отбрасывает совпадения в строках, вытесненных из истории
+     */
+    void discardBefore(qint64 index);
+
+    bool isActive() const { return !m_query.text.isEmpty(); }
+    bool isRunning() const { return m_watcher->isRunning(); }
+    const QString& text() const { return m_query.text; }
+    int matchCount() const { return m_matchCount; }
+    /*!
+     * \brief nextMatch номер первой найденной строки после after, -1 - нет
+     */
+    qint64 nextMatch(qint64 after) const;
+    /*!
+     * \brief previousMatch номер последней найденной строки до before, -1 - нет
+     */
+    qint64 previousMatch(qint64 before) const;
+
+    /*!
+     * \brief indexOf ищет pattern в data (UTF-8). При caseInsensitive pattern должен быть
+     *  в нижнем регистре и содержать только ASCII: регистр байтов data приводится на лету.
+     */
+    static int indexOf(const char* data, int size, const QByteArray& pattern, bool caseInsensitive);
+
+signals:
+    void matchesChanged();
+    void finished();
+
+private:
+    /*!
+     * \brief The Query struct параметры поиска, задачи получают свою копию
+     */
+    struct Query
+    {
+        QString text;
+        QByteArray pattern;         // text в UTF-8 (при поиске без учета регистра - в нижнем регистре)
+        bool caseInsensitive = false;
+        bool unicodeFold = false;   // без учета регистра, но не только ASCII - сравнение через QString
+        QSharedPointer<ConsoleFormatter> filter;
+        qint64 timeFrom = 0;        // окно времени фильтра консоли [timeFrom, timeTo]
+        qint64 timeTo = 0;
+    };
+    typedef QPair<qint64, QVector<qint64>> RangeMatches; // начало диапазона и найденные строки
+
+    /*!
+     * \brief scanRange ищет в строках [from, to), прерывается при смене generation
+     */
+    QVector<qint64> scanRange(const Query& query, qint64 from, qint64 to, int generation) const;
+    void takeResult(int index);
+
+    const LogHistory* m_history;
+    QReadWriteLock* m_lock;
+    QThreadPool* m_pool;
+    QFutureWatcher<RangeMatches>* m_watcher;
+    std::atomic<int> m_generation = 0;
+    Query m_query;
+    QMap<qint64, QVector<qint64>> m_matches; // по началу диапазона, внутри - по возрастанию
+    int m_matchCount = 0;
+    qint64 m_scannedBegin = 0; // с какой строки история уже отдана в поиск
+    qint64 m_scannedEnd = 0;   // до какой
+};
+
+} //namespace Logging
+
+
+#endif // LOGSEARCH_H
@@ -1,5 +1,6 @@
 #include "LogWidgetSettings.h"
 #include "LogConsoleWidget.h"
+#include "LogFileFollower.h"
 #include "qcolordialog.h"
 #include "qdebug.h"
 #include "qfiledialog.h"
@@ -66,6 +67,9 @@ void LogWidgetSettings::loadSettings()
     QMutexLocker locker(&m_console->m_mutex);
 
     ui->lineEdit_logFilePath->setText(m_console->m_logFilePath);
+    ui->checkBox_followLogFile->setChecked(m_console->isFollowingLogFile());
+    // строки собственного файла логов и так приходят в консоль - следить за ним нельзя
+    ui->checkBox_followLogFile->setEnabled(!LogFileFollower::isOwnLogFile(m_console->m_logFilePath));
     ui->lineEdit_ConsoleSettingsPath->setText(m_console->m_settingsFilePath);
 
     QFont font = m_console->m_settings.textFormat.font();
@@ -74,6 +78,8 @@ void LogWidgetSettings::loadSettings()
 
     ui->checkBox_enExtendedColors->setChecked(m_console->m_settings.extendedColors);
     ui->checkBoxRestoreSize->setChecked(m_console->m_settings.restoreWindowPosSize);
+    ui->spinBox_historyMaxLines->setValue(m_console->m_settings.historyMaxLines);
+    ui->spinBox_historyMaxMegabytes->setValue(m_console->m_settings.historyMaxMegabytes);
 
     ui->checkBox_dispDate->setChecked(m_console->m_settings.dispField.date);
     ui->checkBox_dispTime->setChecked(m_console->m_settings.dispField.time);
@@ -82,6 +88,7 @@ void LogWidgetSettings::loadSettings()
     ui->checkBox_dispTimeMs->setChecked(m_console->m_settings.dispField.timeMs);
     ui->checkBox_displogLevel->setChecked(m_console->m_settings.dispField.logLevel);
     ui->checkBox_dispFuncName->setChecked(m_console->m_settings.dispField.messageSource);
+    ui->checkBox_dispCategory->setChecked(m_console->m_settings.dispField.category);
 
     setButtonColor(ui->pushButton_LogLevelColor, m_console->m_settings.colors.logLevel);
     setButtonColor(ui->pushButton_dateColor, m_console->m_settings.colors.date);
@@ -115,12 +122,15 @@ void LogWidgetSettings::saveSettings()
 
     m_console->m_settings.extendedColors = ui->checkBox_enExtendedColors->isChecked();
     m_console->m_settings.restoreWindowPosSize = ui->checkBoxRestoreSize->isChecked();
+    m_console->m_settings.historyMaxLines = ui->spinBox_historyMaxLines->value();
+    m_console->m_settings.historyMaxMegabytes = ui->spinBox_historyMaxMegabytes->value();
 
     m_console->m_settings.dispField.date = ui->checkBox_dispDate->isChecked();
     m_console->m_settings.dispField.time = ui->checkBox_dispTime->isChecked();
     m_console->m_settings.dispField.timeMs = ui->checkBox_dispTimeMs->isChecked();
     m_console->m_settings.dispField.logLevel = ui->checkBox_displogLevel->isChecked();
     m_console->m_settings.dispField.messageSource = ui->checkBox_dispFuncName->isChecked();
+    m_console->m_settings.dispField.category = ui->checkBox_dispCategory->isChecked();
 
     m_console->m_settings.colors.logLevel = m_buttonColors[ui->pushButton_LogLevelColor];
     m_console->m_settings.colors.date = m_buttonColors[ui->pushButton_dateColor];
@@ -232,6 +242,11 @@ void LogWidgetSettings::on_pushButton_openLogFile_clicked()
 
 }
 
+void LogWidgetSettings::on_checkBox_followLogFile_toggled(bool checked)
+{
+    m_console->setFollowLogFile(checked);
+}
+
 
 void LogWidgetSettings::on_pushButton_saveAsConsoleSettings_clicked()
 {
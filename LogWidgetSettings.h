@@ -35,6 +35,8 @@ private slots:
 
     void on_pushButton_openLogFile_clicked();
 
+    void on_checkBox_followLogFile_toggled(bool checked);
+
     void on_pushButton_saveAsConsoleSettings_clicked();
 
 private:
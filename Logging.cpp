@@ -1,24 +1,35 @@
 #include "Logging.h"
 
-#include <QTextStream>
 #include <QDateTime>
 #include <QFile>
 #include <QMutex>
+#include <cstdio>
 #include "LogConsoleWidget.h"
 #include "qcoreapplication.h"
 #include "qdebug.h"
 #include "qdir.h"
+#include "LoggingBackend.h"
 #include "LoggingEncoder.h"
+#include "LoggingRateLimit.h"
+#include "LoggingSinks.h"
+#include "LoggingSymbols.h"
+#include "LoggingTime.h"
 #include "qthread.h"
+#include "qtimer.h"
 
-static QMutex mutex; // только для защиты QFile
-static QScopedPointer<QFile> m_logFile;
+static QMutex mutex; // только для защиты приемников (stdout, файл)
+static Logging::FileSink m_fileSink;
+static Logging::StreamSink m_streamSink;
 
 static std::atomic_bool m_fileExist = false;
 static std::atomic_bool m_enableConsole = true;
 static std::atomic_bool m_enableFile = true;
 static std::atomic_bool m_enableDebug = true;
 static std::atomic_bool m_enableFileEncoding = true;
+static std::atomic_bool m_enableAsync = false;
+static std::atomic<Logging::LogBackend*> m_backend = nullptr;
+static std::atomic_bool m_timedFlushScheduled = false;
+static std::atomic_bool m_suppressReportScheduled = false;
 
 
 
@@ -59,6 +70,95 @@ QtMsgType Logging::StringToMsgType(const QString& str)
 }
 
 
+const int stream_flush_interval_ms = 100; // задержка вывода stdout при блочной буферизации
+const int suppress_report_interval_ms = 1000; // как часто выводить сводку подавленных сообщений
+
+/*!
+ * \brief flushSinks записывает буферы stdout и файла логов
+ */
+static void flushSinks()
+{
+    QMutexLocker locker(&mutex);
+    m_streamSink.flush();
+    m_fileSink.flush();
+}
+
+/*!
+ * \brief registerExitFlush гарантирует сброс буферов при уничтожении QCoreApplication.
+ *  Без QCoreApplication буфер файла сбрасывается в деструкторе FileSink.
+ */
+static void registerExitFlush()
+{
+    static bool registered = false;
+    if(registered || !QCoreApplication::instance()) return;
+    qAddPostRoutine(Logging::shutdown);
+    registered = true;
+}
+
+/*!
+ * \brief scheduleTimedFlush планирует сброс буферов через заданный интервал.
+ *  Таймер запускается в потоке QCoreApplication, поэтому работает и для синхронного,
+ *  и для асинхронного режима. Одновременно запланирован не больше одного сброса.
+ */
+static void scheduleTimedFlush(int intervalMs)
+{
+    QCoreApplication* app = QCoreApplication::instance();
+    if(!app || m_timedFlushScheduled.exchange(true)) return;
+    QMetaObject::invokeMethod(app, [intervalMs](){
+        QTimer::singleShot(intervalMs, QCoreApplication::instance(), [](){
+            m_timedFlushScheduled = false;
+            flushSinks();
+        });
+    }, Qt::QueuedConnection);
+}
+
+/*!
+ * \brief dispatchRecord отправляет запись в очередь асинхронного логирования или выводит сразу
+ */
+static void dispatchRecord(Logging::LogRecord&& record)
+{
+    if(m_enableAsync.load())
+    {
+        Logging::LogBackend* backend = m_backend.load();
+        // после QtFatalMsg приложение завершается, поэтому его выводим синхронно
+        if(record.type == QtFatalMsg)
+            backend->flush();
+        else if(backend->push(std::move(record)))
+            return;
+    }
+    Logging::writeRecords(&record, 1);
+}
+
+static Logging::LogRecord suppressReportRecord(const Logging::RateLimiter::Report& report, qint64 timestamp)
+{
+    Logging::LogRecord record;
+    record.type = report.type;
+    record.timestamp = timestamp;
+    record.functionId = report.functionId;
+    record.categoryId = report.categoryId;
+    record.message = Logging::RateLimiter::reportMessage(report);
+    return record;
+}
+
+/*!
+ * \brief scheduleSuppressReport планирует вывод сводок подавленных сообщений для мест вызова,
+ *  которые замолчали (остальные выводят сводку перед следующим пропущенным сообщением)
+ */
+static void scheduleSuppressReport()
+{
+    QCoreApplication* app = QCoreApplication::instance();
+    if(!app || m_suppressReportScheduled.exchange(true)) return;
+    QMetaObject::invokeMethod(app, [](){
+        QTimer::singleShot(suppress_report_interval_ms, QCoreApplication::instance(), [](){
+            m_suppressReportScheduled = false;
+            qint64 now = Logging::Time::now();
+            const auto reports = Logging::RateLimiter::takeReports();
+            for(const auto& report : reports)
+                dispatchRecord(suppressReportRecord(report, now));
+        });
+    }, Qt::QueuedConnection);
+}
+
 /*!
  * \brief Функция устанавливаем файл для логирования. Если файл не существует
  * логи в файл не пишутся
@@ -69,14 +169,13 @@ void Logging::setLoggingFile(const QString &filePath)
     if(QFile::exists(filePath))
     {
         QMutexLocker locker(&mutex);
-        // Устанавливаем файл логирования
-        m_logFile.reset(new QFile(filePath));
-        // Открываем файл логирования
-        m_logFile.data()->open(QFile::Append | QFile::Text);
-        if(!m_logFile->isOpen())
-            qCritical() << "Could not open log file for writing";
-        //Выставляе флаг разрешения
-        m_fileExist = true;
+        // Устанавливаем и открываем файл логирования
+        //Выставляе флаг разрешения, только если файл открылся
+        m_fileExist = m_fileSink.open(filePath);
+        if(!m_fileExist)
+            fprintf(stderr, "Could not open log file for writing\n");
+        else
+            registerExitFlush();
     }
     else
     {
@@ -84,6 +183,17 @@ void Logging::setLoggingFile(const QString &filePath)
     }
 }
 
+/*!
+ * \brief Функция возвращает путь до файла, в который сейчас пишутся логи,
+ * или пустую строку, если запись в файл не ведется
+ */
+QString Logging::loggingFile()
+{
+    if(!m_fileExist || !m_enableFile) return QString();
+    QMutexLocker locker(&mutex);
+    return m_fileSink.isOpen() ? m_fileSink.fileName() : QString();
+}
+
 /*!
  * \brief Функция устанавливает разрешение на запись логов в файл
  */
@@ -92,6 +202,18 @@ void Logging::setEnableFileLogging(bool enable)
     m_enableFile = enable;
 }
 
+/*!
+ * \brief Функция устанавливает политику сброса буфера файла логов.
+ *  bufferSize - размер буфера в байтах (для FlushBySize, FlushBySizeOrTime),
+ *  intervalMs - максимальное время хранения данных в буфере (для FlushByTime, FlushBySizeOrTime).
+ *  Сообщения QtCriticalMsg и QtFatalMsg записываются сразу при любой политике.
+ */
+void Logging::setFileFlushPolicy(FileFlushPolicy policy, int bufferSize, int intervalMs)
+{
+    QMutexLocker locker(&mutex);
+    m_fileSink.setFlushPolicy(policy, bufferSize, intervalMs);
+}
+
 /*!
  * \brief Функция устанавливает разрешение на отображение логов в консоли
  */
@@ -100,6 +222,15 @@ void Logging::setEnableConsoleLogging(bool enable)
     m_enableConsole = enable;
 }
 
+/*!
+ * \brief Функция выбирает поток (stdout или stderr) для вывода логов в консоль приложения
+ */
+void Logging::setConsoleOutputStream(OutputStream stream)
+{
+    QMutexLocker locker(&mutex);
+    m_streamSink.setStream(stream);
+}
+
 /*!
  * \brief Функция устанавливает разрешение на запись/отображение сообщения типа "Debug"
  */
@@ -109,6 +240,32 @@ void Logging::setEnableDebug(bool enable)
 }
 
 
+/*!
+ * \brief Функция устанавливает маску разрешенных уровней для категории QLoggingCategory.
+ *  levelMask - набор битов (1 << QtMsgType). Сообщения отключенных уровней
+ *  отбрасываются в messageHandler до форматирования и скрываются в консоли.
+ */
+void Logging::setCategoryLevelMask(const QString &category, quint8 levelMask)
+{
+    CategoryTable::setMask(CategoryTable::intern(category), levelMask);
+}
+
+quint8 Logging::categoryLevelMask(const QString &category)
+{
+    return CategoryTable::mask(CategoryTable::intern(category));
+}
+
+/*!
+ * \brief Функция включает ограничение частоты сообщений для каждого места вызова.
+ *  messagesPerSecond - средняя частота, burst - сколько сообщений подряд проходит без ограничения.
+ *  Подавленные сообщения заменяются записью "suppressed N similar messages from ...".
+ *  messagesPerSecond <= 0 отключает ограничение (по умолчанию).
+ */
+void Logging::setRateLimit(int messagesPerSecond, int burst)
+{
+    RateLimiter::setLimit(messagesPerSecond, burst);
+}
+
 /*!
  * \brief Logging::setEnableFileEncoding Включает или отключает кодрование логов в файле
  */
@@ -117,6 +274,59 @@ void Logging::setEnableFileEncoding(bool enable)
     m_enableFileEncoding = enable;
 }
 
+/*!
+ * \brief Logging::setEnableAsyncLogging Включает или отключает асинхронный режим.
+ *  В асинхронном режиме messageHandler только кладет сообщение в очередь,
+ *  а запись в stdout/файл/консоль выполняет отдельный поток.
+ *  При отключении очередь выгружается до конца.
+ */
+void Logging::setEnableAsyncLogging(bool enable)
+{
+    if(enable)
+    {
+        // поток создается один раз и не удаляется до завершения программы,
+        // тк messageHandler может обратиться к нему из любого потока
+        LogBackend* backend = m_backend.load();
+        if(!backend){
+            backend = new LogBackend();
+            m_backend = backend;
+        }
+        backend->start();
+        m_enableAsync = true;
+        registerExitFlush();
+    }
+    else
+    {
+        m_enableAsync = false;
+        if(LogBackend* backend = m_backend.load())
+            backend->stop();
+    }
+}
+
+/*!
+ * \brief Logging::flush ожидает вывода всех сообщений, отправленных до вызова,
+ *  и записывает буферы stdout и файла логов
+ */
+void Logging::flush()
+{
+    if(LogBackend* backend = m_backend.load())
+        backend->flush();
+    flushSinks();
+}
+
+/*!
+ * \brief Logging::shutdown выгружает очередь асинхронного логирования, останавливает поток
+ *  и сбрасывает буферы stdout и файла логов.
+ *  Вызывается автоматически при уничтожении QCoreApplication.
+ */
+void Logging::shutdown()
+{
+    m_enableAsync = false;
+    if(LogBackend* backend = m_backend.load())
+        backend->stop();
+    flushSinks();
+}
+
 /*!
  * \brief Функция логирования для установки в qInstallMessageHandler.
  *  Пример:
@@ -130,72 +340,103 @@ void Logging::messageHandler(QtMsgType type, const QMessageLogContext &context,
 {
     //Если отключен вывод дебаг сообщений и приходит дебаг сообщение, то прерываем метод
     if(!m_enableDebug && type == QtDebugMsg) return;
+    //Если уровень отключен для категории сообщения - прерываем метод до любого форматирования
+    const CategoryTable::CallSite* category = CategoryTable::callSite(context.category);
+    if(!CategoryTable::isEnabled(category, type)) return;
+    quint32 categoryId = category->id;
 
-    //Записываем дату и время
-    QDateTime date = QDateTime::currentDateTime();
-    //QString timeDateStr = date.toString("yyyy-MM-dd hh:mm:ss.zzz");
-
-
+    qint64 now = Time::now(); //Записываем дату и время
+    quint32 functionId = FunctionTable::idForCallSite(context.function);
 
-    // Ищем подстроку, которая начинается с последнего пробела
-    QString func = context.function;
-    int lastIndex = func.lastIndexOf('(');
-    func = func.left(lastIndex).trimmed();
-
-    int firstIndex = func.lastIndexOf(' ');
-    func = func.mid(firstIndex+1);
-    //QStringList list = func.split("::");
+    //Ограничение частоты по месту вызова (без блокировок, до форматирования)
+    if(RateLimiter::isEnabled())
+    {
+        RateLimiter::Report report;
+        if(!RateLimiter::allow(context, type, msg, functionId, categoryId, now, report)){
+            scheduleSuppressReport();
+            return;
+        }
+        if(report.suppressed)
+            dispatchRecord(suppressReportRecord(report, now));
+    }
 
+    LogRecord record;
+    record.type = type;
+    record.categoryId = categoryId;
+    record.timestamp = now;
+    record.functionId = functionId;
+    record.message = msg;
+    dispatchRecord(std::move(record));
+}
 
-    QString str;
-    //По типу определяем, к какому уровню относится сообщение
-    // QString typeMsg = msgTypeToString(type);
-    // str = QString("%1 %2 %3 >> %4").arg(timeDateStr, typeMsg, func, msg);
-    //LogLine(type, date, func, msg);
-    str = LogLine(type, date, func, msg).toQString();
-    QString encodedStr;
-    if(m_enableFileEncoding && m_fileExist && m_enableFile)
+void Logging::writeRecords(const LogRecord *records, int count)
+{
+    bool toConsole = m_enableConsole;
+    bool toFile = m_fileExist && m_enableFile;
+    bool encode = m_enableFileEncoding && toFile;
+
+    //формируем строки до захвата мьютекса.
+    //строка кодируется в UTF-8 один раз, эти же байты идут в stdout и в файл
+    QVector<LogLine> logLines;
+    QByteArray plainData;
+    QByteArray encodedData;
+    bool urgent = false;
+    logLines.reserve(count);
+    for(int i = 0; i < count; i++)
     {
-        encodedStr = Logging::Encoder::encodeLineString(str);
+        const LogRecord& r = records[i];
+        logLines.append(LogLine(r.type, r.timestamp, r.functionId, r.message, r.categoryId));
+        if(toConsole || toFile)
+        {
+            QByteArray utf8 = logLines.last().toQString().toUtf8();
+            if(encode){
+                // base64 пишется сразу в буфер пачки
+                Logging::Encoder::appendEncodedLine(utf8.constData(), utf8.size(), encodedData);
+                encodedData += '\n';
+            }
+            if(toConsole || !encode){
+                plainData += utf8;
+                plainData += '\n';
+            }
+        }
+        urgent |= (r.type == QtCriticalMsg || r.type == QtFatalMsg);
     }
 
-    //В зависимости от установленных флагов выводим сообщение
+    //В зависимости от установленных флагов выводим сообщения
     //в консоль и пишем в файл
+    bool pendingData = false;
+    int flushInterval = 0;
     {
         QMutexLocker locker(&mutex);
-        if(m_enableConsole)
+        // (qCritical здесь нельзя - обработчик повторно захватит мьютекс)
+        if(toConsole)
         {
-            QTextStream out(stdout);
-            out << str << '\n';
-            //std::cout << str.toStdString() << std::endl;
-            out.flush();
-            if (out.status() != QTextStream::Ok) {
-                qCritical() << "Console write error!";
+            if(!m_streamSink.write(plainData, urgent))
+                fprintf(stderr, "Console write error!\n");
+            if(m_streamSink.hasPendingData()){
+                pendingData = true;
+                flushInterval = stream_flush_interval_ms;
             }
         }
-        if(m_fileExist && m_enableFile)
+        if(toFile)
         {
-            QTextStream out(m_logFile.data());
-            if(!encodedStr.isEmpty())
-                out << encodedStr << Qt::endl;
-            else
-                out << str << Qt::endl;
-            out.flush();
-            // Проверка ошибки после записи
-            if (out.status() != QTextStream::Ok ||
-                m_logFile->error() != QFile::NoError) {
-                qCritical() << "File log write error:" << m_logFile->errorString();
+            if(!m_fileSink.write(encode ? encodedData : plainData, urgent))
+                fprintf(stderr, "File log write error: %s\n", qPrintable(m_fileSink.errorString()));
+            FileFlushPolicy policy = m_fileSink.flushPolicy();
+            if(m_fileSink.hasPendingData() && (policy == FlushByTime || policy == FlushBySizeOrTime)){
+                flushInterval = pendingData ? qMin(flushInterval, m_fileSink.flushInterval())
+                                            : m_fileSink.flushInterval();
+                pendingData = true;
             }
         }
     }
+    if(pendingData)
+        scheduleTimedFlush(flushInterval);
 
     auto c = m_consoleInstance.load();
     if(c){
-        if(QThread::currentThread() != qApp->thread()){
-            emit c->sigAppendFormatedLine(type, date, func, msg);
-        } else {
-            c->appendFormatedLine(type, date, func, msg);
-        }
+        // строки копятся в буфере консоли и добавляются GUI потоком раз в кадр
+        c->postLines(logLines);
     }
 }
 
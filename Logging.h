@@ -20,11 +20,40 @@ class LogConsoleWidget;
 QString msgTypeToString(const QtMsgType type) ;
 QtMsgType StringToMsgType(const QString& str) ;
 
+/*!
+ * \brief The FileFlushPolicy enum политика сброса буфера файла логов на диск
+ */
+enum FileFlushPolicy
+{
+    FlushEveryLine,     // сразу после каждой записи (по умолчанию)
+    FlushBySize,        // при заполнении буфера
+    FlushByTime,        // не реже заданного интервала
+    FlushBySizeOrTime   // при заполнении буфера или по интервалу
+};
+
+/*!
+ * \brief The OutputStream enum стандартный поток для вывода логов в консоль приложения
+ */
+enum OutputStream
+{
+    StandardOutput,
+    StandardError
+};
+
 void setLoggingFile(const QString &filePath);
+QString loggingFile();
 void setEnableFileLogging(bool enable);
+void setFileFlushPolicy(FileFlushPolicy policy, int bufferSize = 64 * 1024, int intervalMs = 1000);
 void setEnableConsoleLogging(bool enable);
+void setConsoleOutputStream(OutputStream stream);
 void setEnableDebug(bool enable);
+void setCategoryLevelMask(const QString& category, quint8 levelMask);
+quint8 categoryLevelMask(const QString& category);
+void setRateLimit(int messagesPerSecond, int burst = 10);
 void setEnableFileEncoding(bool enable);
+void setEnableAsyncLogging(bool enable);
+void flush();
+void shutdown();
 void setLogConsole(LogConsoleWidget *Console);
 LogConsoleWidget* getLogConsole();
 void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg);
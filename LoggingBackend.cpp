@@ -0,0 +1,132 @@
+#include "LoggingBackend.h"
+
+using namespace Logging;
+
+const int batch_size = 512; // максимальное количество сообщений в одной пачке
+const int idle_wait_ms = 50; // сколько поток спит при пустой очереди
+
+LogBackend::LogBackend(size_t capacity) :
+    m_queue(capacity)
+{
+    setObjectName("LogBackend");
+    m_batch.reserve(batch_size);
+}
+
+LogBackend::~LogBackend()
+{
+    stop();
+}
+
+void LogBackend::start()
+{
+    if(isRunning()) return;
+    m_running = true;
+    QThread::start();
+}
+
+bool LogBackend::push(LogRecord &&record)
+{
+    // сообщение из самого потока (например, предупреждение Qt внутри приемника):
+    // при заполненной очереди освобождать место было бы некому
+    if(QThread::currentThread() == this) return false;
+    // поток при остановке дожидается, пока m_producers не станет 0, поэтому сообщение,
+    // прошедшее проверку m_running, обязательно будет выгружено
+    m_producers++;
+    if(!m_running.load()){
+        m_producers--;
+        return false;
+    }
+    // очередь заполнена - будим поток и уступаем ему процессор
+    while(!m_queue.tryPush(std::move(record))){
+        if(!m_running.load()){
+            m_producers--;
+            return false;
+        }
+        wakeUp();
+        QThread::yieldCurrentThread();
+    }
+    m_producers--;
+    // будим поток только если он уснул на пустой очереди
+    if(m_sleeping.load())
+        wakeUp();
+    return true;
+}
+
+void LogBackend::flush()
+{
+    if(!m_running.load() || QThread::currentThread() == this) return;
+    size_t target = m_queue.pushedCount();
+
+    QMutexLocker locker(&m_waitMutex);
+    m_flushWaiters++;
+    while(m_written.load() < target && m_running.load()){
+        m_wake.wakeOne();
+        m_flushed.wait(&m_waitMutex, idle_wait_ms);
+    }
+    m_flushWaiters--;
+}
+
+void LogBackend::stop()
+{
+    if(!isRunning()) return;
+    m_stop = true;
+    wakeUp();
+    wait();
+    m_stop = false;
+    // поток остановлен, дочитываем то, что успели положить во время остановки
+    while(drain() > 0);
+}
+
+void LogBackend::run()
+{
+    for(;;)
+    {
+        if(drain() > 0) continue;
+        if(m_stop.load()) break;
+
+        QMutexLocker locker(&m_waitMutex);
+        m_sleeping = true;
+        if(m_queue.empty() && !m_stop.load())
+            m_wake.wait(&m_waitMutex, idle_wait_ms);
+        m_sleeping = false;
+    }
+    // новые push() с этого момента выводят сообщения сами, а начатые
+    // дожидаемся: их сообщения появятся в очереди до того, как m_producers станет 0
+    m_running = false;
+    for(;;)
+    {
+        bool idle = m_producers.load() == 0;
+        while(drain() > 0);
+        if(idle) break;
+        QThread::yieldCurrentThread();
+    }
+    // отпускаем тех, кто ждет в flush()
+    QMutexLocker locker(&m_waitMutex);
+    m_flushed.wakeAll();
+}
+
+int LogBackend::drain()
+{
+    LogRecord record;
+    while(m_batch.size() < batch_size && m_queue.tryPop(record))
+        m_batch.append(std::move(record));
+
+    int count = m_batch.size();
+    if(!count) return 0;
+
+    writeRecords(m_batch.constData(), count);
+    m_batch.clear();
+    m_written += count;
+
+    if(m_flushWaiters.load() > 0){
+        QMutexLocker locker(&m_waitMutex);
+        m_flushed.wakeAll();
+    }
+    return count;
+}
+
+void LogBackend::wakeUp()
+{
+    QMutexLocker locker(&m_waitMutex);
+    m_wake.wakeOne();
+}
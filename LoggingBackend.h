@@ -0,0 +1,88 @@
+#ifndef LOGGINGBACKEND_H
+#define LOGGINGBACKEND_H
+
+#include "LoggingQueue.h"
+#include "qmutex.h"
+#include "qthread.h"
+#include "qwaitcondition.h"
+#include <QString>
+
+
+namespace Logging {
+
+/*!
+ * \brief The LogRecord struct "сырое" сообщение, захваченное в messageHandler.
+ *  Форматирование выполняется уже в приемниках (sinks).
+ *  Имя функции хранится как id из FunctionTable.
+ */
+struct LogRecord
+{
+    QtMsgType type = QtDebugMsg;
+    qint64 timestamp = 0; // локальное время в мс (см. LoggingTime.h)
+    quint32 functionId = 0;
+    quint32 categoryId = 0; // id из CategoryTable
+    QString message;
+};
+
+/*!
+ * \brief writeRecords выводит пачку сообщений во все включенные приемники
+ *  (stdout, файл, LogConsoleWidget). Реализована в Logging.cpp
+ */
+void writeRecords(const LogRecord* records, int count);
+
+/*!
+ * \brief The LogBackend class фоновый поток асинхронного логирования.
+ *  messageHandler только кладет сообщение в lock-free очередь,
+ *  а поток пачками выгружает ее в приемники.
+ */
+class LogBackend : public QThread
+{
+public:
+    explicit LogBackend(size_t capacity = 1 << 16);
+    ~LogBackend();
+
+    /*!
+     * \brief start запускает поток. С этого момента push() принимает сообщения
+     */
+    void start();
+    /*!
+     * \brief push кладет сообщение в очередь. Можно вызывать из любых потоков.
+     *  Если очередь заполнена - ждет пока поток освободит место (сообщения не теряются).
+     *  Возвращает false если поток не запущен или останавливается, а также при вызове из самого
+     *  потока (сообщение из приемника) - тогда сообщение нужно вывести синхронно.
+     */
+    bool push(LogRecord&& record);
+    /*!
+     * \brief flush ожидает пока все сообщения, отправленные до вызова, будут выведены
+     */
+    void flush();
+    /*!
+     * \brief stop выгружает очередь и останавливает поток
+     */
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    int drain(); // выгружает одну пачку, возвращает количество выведенных сообщений
+    void wakeUp();
+
+    BoundedMPSCQueue<LogRecord> m_queue;
+    QVector<LogRecord> m_batch;
+    std::atomic_bool m_running = false;
+    std::atomic_bool m_stop = false;
+    std::atomic_bool m_sleeping = false;
+    std::atomic_int m_producers = 0; // потоки внутри push()
+    std::atomic<size_t> m_written = 0;
+    std::atomic_int m_flushWaiters = 0;
+
+    QMutex m_waitMutex;
+    QWaitCondition m_wake;
+    QWaitCondition m_flushed;
+};
+
+} //namespace Logging
+
+
+#endif // LOGGINGBACKEND_H
@@ -0,0 +1,78 @@
+#ifndef LOGGINGCONCURRENT_H
+#define LOGGINGCONCURRENT_H
+
+#include "qfuture.h"
+#include "qfutureinterface.h"
+#include "qrunnable.h"
+#include "qsharedpointer.h"
+#include "qthreadpool.h"
+#include "qvector.h"
+#include <functional>
+
+
+namespace Logging {
+
+namespace Concurrent {
+
+/*!
+ * \brief The MappedState struct общее состояние задач mapped(..)
+ */
+template <typename Result, typename Input>
+struct MappedState
+{
+    QFutureInterface<Result> future;
+    std::function<Result(const Input&)> map;
+    QAtomicInt remaining; // незавершенные задачи, последняя завершает future
+};
+
+template <typename Result, typename Input>
+class MappedTask : public QRunnable
+{
+public:
+    MappedTask(const QSharedPointer<MappedState<Result, Input>>& state, const Input& input, int index) :
+        m_state(state), m_input(input), m_index(index) {}
+
+    void run() override
+    {
+        if(!m_state->future.isCanceled())
+            m_state->future.reportResult(m_state->map(m_input), m_index);
+        if(!m_state->remaining.deref())
+            m_state->future.reportFinished();
+    }
+
+private:
+    QSharedPointer<MappedState<Result, Input>> m_state;
+    Input m_input;
+    int m_index;
+};
+
+/*!
+ * \brief mapped выполняет map для каждого элемента inputs задачами пула pool, по одной на элемент
+ *  (QtConcurrent::mapped в Qt 5 работает только в глобальном пуле приложения).
+ *  Результат i соответствует inputs[i] и доступен сразу по готовности (QFutureWatcher::resultReadyAt).
+ *  Задачи ставятся в очередь пула по порядку, освободившийся поток берет следующую.
+ *  Отмена future пропускает не начатые задачи, future завершается после последней задачи
+ */
+template <typename Result, typename Input>
+QFuture<Result> mapped(QThreadPool* pool, const QVector<Input>& inputs, std::function<Result(const Input&)> map)
+{
+    QSharedPointer<MappedState<Result, Input>> state(new MappedState<Result, Input>);
+    state->map = std::move(map);
+    state->remaining = inputs.size();
+    state->future.reportStarted();
+    QFuture<Result> future = state->future.future();
+    if(inputs.isEmpty()){
+        state->future.reportFinished();
+        return future;
+    }
+    for(int i = 0; i < inputs.size(); i++)
+        pool->start(new MappedTask<Result, Input>(state, inputs.at(i), i));
+    return future;
+}
+
+} //namespace Concurrent
+
+} //namespace Logging
+
+
+#endif // LOGGINGCONCURRENT_H
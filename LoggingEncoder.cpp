@@ -0,0 +1,360 @@
+#include "LoggingEncoder.h"
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define LOGGINGENCODER_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define LOGGINGENCODER_TARGET(arch)
+#else
+#define LOGGINGENCODER_TARGET(arch) __attribute__((target(arch)))
+#endif
+#endif
+
+using namespace Logging;
+
+namespace {
+
+const char encode_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/*!
+ * \brief The DecodeTable struct значение символа base64, -1 - не символ base64
+ */
+struct DecodeTable
+{
+    signed char values[256];
+    DecodeTable()
+    {
+        for(int i = 0; i < 256; i++)
+            values[i] = -1;
+        for(int i = 0; i < 64; i++)
+            values[uchar(encode_table[i])] = (signed char)i;
+    }
+};
+const DecodeTable decode_table;
+
+Encoder::Base64Kernel detectKernel()
+{
+#ifdef LOGGINGENCODER_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool ssse3 = info[2] & (1 << 9);
+    // AVX2 нужна и поддержка ОС: сохранение регистров YMM (OSXSAVE и XCR0)
+    bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if(avx && maxLeaf >= 7){
+        __cpuidex(info, 7, 0);
+        avx2 = info[1] & (1 << 5);
+    }
+    if(avx2) return Encoder::Base64Avx2;
+    if(ssse3) return Encoder::Base64Ssse3;
+#else
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return Encoder::Base64Avx2;
+    if(__builtin_cpu_supports("ssse3")) return Encoder::Base64Ssse3;
+#endif
+#endif
+    return Encoder::Base64Scalar;
+}
+
+Encoder::Base64Kernel detectedKernel()
+{
+    static const Encoder::Base64Kernel detected = detectKernel();
+    return detected;
+}
+
+std::atomic<int> forced_kernel(-1); // setBase64Kernel(..), -1 - по процессору
+
+/*!
+ * \brief encodeScalar кодирует целые тройки и хвост с '='
+ */
+void encodeScalar(const uchar* in, int size, char* out)
+{
+    int i = 0;
+    for(; size - i >= 3; i += 3)
+    {
+        quint32 v = (quint32(in[i]) << 16) | (quint32(in[i + 1]) << 8) | in[i + 2];
+        *out++ = encode_table[v >> 18];
+        *out++ = encode_table[(v >> 12) & 0x3f];
+        *out++ = encode_table[(v >> 6) & 0x3f];
+        *out++ = encode_table[v & 0x3f];
+    }
+    if(size - i == 1)
+    {
+        quint32 v = quint32(in[i]) << 16;
+        *out++ = encode_table[v >> 18];
+        *out++ = encode_table[(v >> 12) & 0x3f];
+        *out++ = '=';
+        *out++ = '=';
+    }
+    else if(size - i == 2)
+    {
+        quint32 v = (quint32(in[i]) << 16) | (quint32(in[i + 1]) << 8);
+        *out++ = encode_table[v >> 18];
+        *out++ = encode_table[(v >> 12) & 0x3f];
+        *out++ = encode_table[(v >> 6) & 0x3f];
+        *out++ = '=';
+    }
+}
+
+/*!
+ * \brief decodeScalar строгий разбор: '=' допускается только в конце, остаток без '=' - как в
+ *  QByteArray::fromBase64. -1 - встретился другой символ (его разбирает QByteArray::fromBase64)
+ */
+int decodeScalar(const uchar* in, int size, uchar* out)
+{
+    const signed char* values = decode_table.values;
+    uchar* start = out;
+    int i = 0;
+    for(; size - i >= 4; i += 4)
+    {
+        int a = values[in[i]], b = values[in[i + 1]], c = values[in[i + 2]], d = values[in[i + 3]];
+        if((a | b | c | d) < 0)
+        {
+            // последняя четверка: "xx==" или "xxx="
+            if(size - i != 4 || a < 0 || b < 0 || in[i + 3] != '=') return -1;
+            *out++ = uchar((a << 2) | (b >> 4));
+            if(in[i + 2] == '=') return int(out - start);
+            if(c < 0) return -1;
+            *out++ = uchar((b << 4) | (c >> 2));
+            return int(out - start);
+        }
+        quint32 v = (quint32(a) << 18) | (quint32(b) << 12) | (quint32(c) << 6) | quint32(d);
+        *out++ = uchar(v >> 16);
+        *out++ = uchar(v >> 8);
+        *out++ = uchar(v);
+    }
+    int rest = size - i;
+    if(rest >= 2)
+    {
+        int a = values[in[i]], b = values[in[i + 1]];
+        if((a | b) < 0) return -1;
+        *out++ = uchar((a << 2) | (b >> 4));
+        if(rest == 3)
+        {
+            int c = values[in[i + 2]];
+            if(c < 0) return -1;
+            *out++ = uchar((b << 4) | (c >> 2));
+        }
+    }
+    else if(rest == 1 && values[in[i]] < 0) return -1;
+    return int(out - start);
+}
+
+#ifdef LOGGINGENCODER_X86
+
+// Векторные ядра (W. Muła, D. Lemire): 12 байт -> 16 символов и обратно на 128-битную половину регистра.
+// Разбираются только целые блоки без '=', остаток и ошибки - скалярным кодом.
+
+LOGGINGENCODER_TARGET("ssse3")
+int encodeSsse3(const uchar* in, int size, char* out)
+{
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i shiftLut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    int i = 0;
+    // загружается 16 байт, используется 12
+    for(; size - i >= 16; i += 12, out += 16)
+    {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), shuffle);
+        __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(t0, t1);
+        // смещение до ASCII по диапазону индекса: A-Z, a-z, 0-9, '+', '/'
+        __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+        __m128i ascii = _mm_add_epi8(_mm_shuffle_epi8(shiftLut, range), indices);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), ascii);
+    }
+    return i;
+}
+
+LOGGINGENCODER_TARGET("avx2")
+int encodeAvx2(const uchar* in, int size, char* out)
+{
+    const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                             1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i shiftLut = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                              'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    int i = 0;
+    // по 12 байт в каждую половину регистра, вторая загрузка читает 16 байт с in + 12
+    for(; size - i >= 28; i += 24, out += 32)
+    {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12));
+        __m256i v = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), shuffle);
+        __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(t0, t1);
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+        __m256i ascii = _mm256_add_epi8(_mm256_shuffle_epi8(shiftLut, range), indices);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), ascii);
+    }
+    return i;
+}
+
+/*!
+ * \brief decodeSsse3 целые блоки по 16 символов. Блок с другим символом (и '=') не разбирается:
+ *  возвращается число разобранных символов, out сдвигается на 12 байт за блок.
+ *  Пишет 16 байт на блок, поэтому после последнего блока остается не меньше 8 символов
+ */
+LOGGINGENCODER_TARGET("ssse3")
+int decodeSsse3(const uchar* in, int size, uchar*& out)
+{
+    // биты допустимых символов по младшей и старшей тетраде: пересечение - недопустимый символ
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask2F = _mm_set1_epi8(0x2F);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    int i = 0;
+    for(; size - i >= 24; i += 16, out += 12)
+    {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask2F);
+        __m128i loNibbles = _mm_and_si128(str, mask2F);
+        __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+        __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+        if(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128()))) break;
+        __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(_mm_cmpeq_epi8(str, mask2F), hiNibbles));
+        str = _mm_add_epi8(str, roll);
+        // 4 x 6 бит -> 3 байта
+        __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(merged, pack));
+    }
+    return i;
+}
+
+LOGGINGENCODER_TARGET("avx2")
+int decodeAvx2(const uchar* in, int size, uchar*& out)
+{
+    const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                           0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                           0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask2F = _mm256_set1_epi8(0x2F);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    int i = 0;
+    // пишет 32 байта на блок из 24: после последнего блока остается не меньше 16 символов
+    for(; size - i >= 48; i += 32, out += 24)
+    {
+        __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask2F);
+        __m256i loNibbles = _mm256_and_si256(str, mask2F);
+        __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+        __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+        if(_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256()))) break;
+        __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(_mm256_cmpeq_epi8(str, mask2F), hiNibbles));
+        str = _mm256_add_epi8(str, roll);
+        __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack);
+        // 12 байт из каждой половины подряд
+        merged = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), merged);
+    }
+    return i;
+}
+
+#endif // LOGGINGENCODER_X86
+
+} //namespace
+
+
+Encoder::Base64Kernel Encoder::base64Kernel()
+{
+    int forced = forced_kernel.load(std::memory_order_relaxed);
+    return forced >= 0 ? Base64Kernel(forced) : detectedKernel();
+}
+
+bool Encoder::setBase64Kernel(Base64Kernel kernel)
+{
+    if(kernel > detectedKernel()) return false;
+    forced_kernel.store(kernel, std::memory_order_relaxed);
+    return true;
+}
+
+int Encoder::encodeBase64(const char *data, int size, char *out)
+{
+    const uchar* in = reinterpret_cast<const uchar*>(data);
+    int done = 0;
+#ifdef LOGGINGENCODER_X86
+    switch(base64Kernel()){
+    case Base64Avx2:
+        done = encodeAvx2(in, size, out);
+        break;
+    case Base64Ssse3:
+        done = encodeSsse3(in, size, out);
+        break;
+    case Base64Scalar:
+        break;
+    }
+#endif
+    encodeScalar(in + done, size - done, out + done / 3 * 4);
+    return base64Size(size);
+}
+
+int Encoder::decodeBase64(const char *data, int size, char *out)
+{
+    const uchar* in = reinterpret_cast<const uchar*>(data);
+    uchar* o = reinterpret_cast<uchar*>(out);
+    int done = 0;
+#ifdef LOGGINGENCODER_X86
+    switch(base64Kernel()){
+    case Base64Avx2:
+        done = decodeAvx2(in, size, o);
+        // остаток или блок с ошибкой - по 16 символов
+        done += decodeSsse3(in + done, size - done, o);
+        break;
+    case Base64Ssse3:
+        done = decodeSsse3(in, size, o);
+        break;
+    case Base64Scalar:
+        break;
+    }
+#endif
+    int tail = decodeScalar(in + done, size - done, o);
+    if(tail >= 0)
+        return int(o - reinterpret_cast<uchar*>(out)) + tail;
+
+    // недопустимые символы пропускаются - результат тот же, что у прежнего декодирования
+    QByteArray decoded = QByteArray::fromBase64(QByteArray::fromRawData(data, size), QByteArray::Base64Encoding);
+    memcpy(out, decoded.constData(), size_t(decoded.size()));
+    return decoded.size();
+}
+
+void Encoder::appendEncodedLine(const char *data, int size, QByteArray &out)
+{
+    int from = out.size();
+    out.resize(from + PrefixMarker.size() + base64Size(size));
+    char* p = out.data() + from;
+    memcpy(p, PrefixMarker.constData(), size_t(PrefixMarker.size()));
+    encodeBase64(data, size, p + PrefixMarker.size());
+}
+
+bool Encoder::decodeLine(const char *data, int size, QByteArray &out)
+{
+    if(!isLineDataEncoded(QByteArray::fromRawData(data, size))) return false;
+    data += PrefixMarker.size();
+    size -= PrefixMarker.size();
+    out.resize(base64DecodedMaxSize(size));
+    out.resize(decodeBase64(data, size, out.data()));
+    return true;
+}
@@ -8,6 +8,52 @@ namespace Encoder {
 
     static const QByteArray PrefixMarker = QByteArray(1, 'E');
 
+    /*!
+     * \brief base64Size длина base64 (с '=') для size байт
+     */
+    inline int base64Size(int size) { return (size + 2) / 3 * 4; }
+    /*!
+     * \brief base64DecodedMaxSize размер буфера для декодирования size символов base64
+     */
+    inline int base64DecodedMaxSize(int size) { return (size + 3) / 4 * 3; }
+    /*!
+     * \brief The Base64Kernel enum векторное ядро base64 (каждое следующее требует и предыдущие)
+     */
+    enum Base64Kernel
+    {
+        Base64Scalar,   // по таблице
+        Base64Ssse3,
+        Base64Avx2
+    };
+    /*!
+     * \brief base64Kernel ядро, которым работают encodeBase64/decodeBase64
+     */
+    Base64Kernel base64Kernel();
+    /*!
+     * \brief setBase64Kernel задает ядро вместо выбранного по процессору (тесты сравнивают все ядра
+     *  на одной машине). Ядро, которое процессор не поддерживает, не задается - возвращается false
+     */
+    bool setBase64Kernel(Base64Kernel kernel);
+    /*!
+     * \brief encodeBase64 кодирует data[0, size) в out (base64Size(size) байт), возвращает их число.
+     *  Векторное ядро (AVX2 или SSSE3) выбирается по процессору при первом вызове, иначе - по таблице
+     */
+    int encodeBase64(const char* data, int size, char* out);
+    /*!
+     * \brief decodeBase64 декодирует data[0, size) в out (base64DecodedMaxSize(size) байт),
+     *  возвращает число байт. Результат совпадает с QByteArray::fromBase64: строки с недопустимыми
+     *  символами разбираются им
+     */
+    int decodeBase64(const char* data, int size, char* out);
+    /*!
+     * \brief appendEncodedLine дописывает в out зашифрованную строку data[0, size): маркер и base64
+     */
+    void appendEncodedLine(const char* data, int size, QByteArray& out);
+    /*!
+     * \brief decodeLine расшифровывает строку с маркером в out (буфер переиспользуется между строками).
+     *  false - строка не зашифрована
+     */
+    bool decodeLine(const char* data, int size, QByteArray& out);
 
 
     inline bool isLineDataEncoded(const QByteArray& lineData){
@@ -17,15 +63,16 @@ namespace Encoder {
     inline QByteArray encodeLineData(const QByteArray& lineData){
         QByteArray encoded;
         //add first marker for encoding recognition
-        encoded = PrefixMarker + lineData.toBase64(QByteArray::Base64Encoding);
+        appendEncodedLine(lineData.constData(), lineData.size(), encoded);
         return encoded;
     }
     inline QByteArray decodeLineData(const QByteArray& lineData){
         //skip first marker
         if(lineData.size() < PrefixMarker.size()) return QByteArray();
 
-        QByteArray encodedPart = lineData.mid(PrefixMarker.size());
-        QByteArray decoded = QByteArray::fromBase64(encodedPart, QByteArray::Base64Encoding);
+        int size = lineData.size() - PrefixMarker.size();
+        QByteArray decoded(base64DecodedMaxSize(size), Qt::Uninitialized);
+        decoded.resize(decodeBase64(lineData.constData() + PrefixMarker.size(), size, decoded.data()));
         return decoded;
     }
 
@@ -0,0 +1,116 @@
+#ifndef LOGGINGQUEUE_H
+#define LOGGINGQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+
+namespace Logging {
+
+/*!
+ * \brief The BoundedMPSCQueue class ограниченная по размеру lock-free очередь
+ *  "много писателей - один читатель" (кольцевой буфер с номерами последовательностей).
+ *  Писатели резервируют ячейку одной операцией CAS над позицией записи,
+ *  читатель забирает элементы без блокировок и атомарных RMW операций.
+ *  Размер буфера всегда округляется до степени двойки.
+ */
+template<typename T>
+class BoundedMPSCQueue
+{
+public:
+    explicit BoundedMPSCQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while(size < capacity) size <<= 1;
+        m_mask = size - 1;
+        m_cells = new Cell[size];
+        for(size_t i = 0; i < size; i++)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        m_enqueuePos.store(0, std::memory_order_relaxed);
+        m_dequeuePos = 0;
+    }
+    ~BoundedMPSCQueue(){ delete[] m_cells; }
+
+    BoundedMPSCQueue(const BoundedMPSCQueue&) = delete;
+    BoundedMPSCQueue& operator=(const BoundedMPSCQueue&) = delete;
+
+    /*!
+     * \brief tryPush кладет элемент в очередь. Можно вызывать из любых потоков.
+     *  Возвращает false если очередь заполнена (элемент не перемещается).
+     */
+    bool tryPush(T&& value)
+    {
+        Cell* cell;
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for(;;)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if(diff == 0)
+            {
+                if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if(diff < 0)
+                return false; // очередь заполнена
+            else
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+     * \brief tryPop забирает элемент из очереди. Вызывать только из потока-читателя!
+     */
+    bool tryPop(T& value)
+    {
+        Cell* cell = &m_cells[m_dequeuePos & m_mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        if((intptr_t)seq - (intptr_t)(m_dequeuePos + 1) < 0)
+            return false; // очередь пуста или писатель еще не закончил запись в ячейку
+        value = std::move(cell->data);
+        cell->data = T();
+        cell->sequence.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+        m_dequeuePos++;
+        return true;
+    }
+
+    /*!
+     * \brief empty проверяет наличие готовых к чтению элементов. Вызывать только из потока-читателя!
+     */
+    bool empty() const
+    {
+        const Cell* cell = &m_cells[m_dequeuePos & m_mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        return (intptr_t)seq - (intptr_t)(m_dequeuePos + 1) < 0;
+    }
+
+    /*!
+     * \brief pushedCount количество зарезервированных писателями ячеек за все время
+     */
+    size_t pushedCount() const { return m_enqueuePos.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return m_mask + 1; }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    Cell* m_cells = nullptr;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_enqueuePos;
+    alignas(64) size_t m_dequeuePos;
+};
+
+} //namespace Logging
+
+
+#endif // LOGGINGQUEUE_H
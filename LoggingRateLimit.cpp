@@ -0,0 +1,181 @@
+#include "LoggingRateLimit.h"
+#include "LoggingSymbols.h"
+#include "qhash.h"
+#include <atomic>
+
+using namespace Logging;
+
+const quint32 limiter_slots = 4096;  // число отслеживаемых мест вызова (степень двойки)
+const quint32 limiter_probes = 16;   // длина поиска в таблице
+
+namespace {
+
+/*!
+ * \brief The Site struct состояние места вызова. Ключ меняется только CAS:
+ *  захват свободной ячейки или ячейки, место вызова которой затихло (см. findSite).
+ *  Описание места записывается захватившим потоком между ready = false и ready = true.
+ */
+struct Site
+{
+    std::atomic<quint64> key = 0;
+    std::atomic<bool> ready = false;
+    std::atomic<qint64> tat = 0;           // теоретическое время следующего сообщения, мкс
+    std::atomic<quint32> suppressed = 0;   // подавлено с последней сводки
+    std::atomic<QtMsgType> type = QtDebugMsg;
+    std::atomic<quint32> functionId = 0;
+    std::atomic<quint32> categoryId = 0;
+    std::atomic<const char*> file = nullptr;
+    std::atomic<int> line = 0;
+};
+
+Site sites[limiter_slots];
+Site overflowSite; // общее ведро для мест вызова, которым не хватило ячеек
+std::atomic<qint64> emissionIntervalUs = 0; // 1 / частота, 0 - ограничение отключено
+std::atomic<qint64> burstToleranceUs = 0;   // (burst - 1) * emissionIntervalUs
+
+inline quint64 mix(quint64 v)
+{
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdULL;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ULL;
+    v ^= v >> 33;
+    return v;
+}
+
+quint64 siteKey(const QMessageLogContext& context, QtMsgType type, const QString& msg)
+{
+    quint64 key;
+    if(context.file || context.function)
+        key = mix((quint64)(quintptr)context.file ^ ((quint64)context.line << 40))
+              ^ mix((quint64)(quintptr)context.function);
+    else
+        key = mix(((quint64)qHash(msg) << 8) | (quint64)type); // повторы одного и того же текста
+    return key ? key : 1; // 0 - свободная ячейка
+}
+
+/*!
+ * \brief isIdle место вызова затихло: ведро снова полное (TAT не позже now)
+ *  и неотчитанных подавлений нет. Такое состояние не отличается от свежей ячейки,
+ *  поэтому ячейку можно отдать другому месту вызова без потери ограничения
+ */
+bool isIdle(const Site& site, qint64 nowUs)
+{
+    return site.tat.load(std::memory_order_relaxed) <= nowUs
+           && site.suppressed.load(std::memory_order_relaxed) == 0;
+}
+
+/*!
+ * \brief findSite ищет ячейку места вызова, при отсутствии занимает свободную
+ *  или затихшую. Без освобождения таблица после limiter_slots разных мест
+ *  (в release - разных текстов) перестала бы ограничивать новые сообщения.
+ *  Если все ячейки цепочки заняты активными местами, сообщение идет через общее ведро.
+ */
+Site* findSite(quint64 key, QtMsgType type, quint32 functionId, quint32 categoryId,
+               const QMessageLogContext& context, qint64 nowUs)
+{
+    for(quint32 i = 0; i < limiter_probes; i++)
+    {
+        Site& site = sites[(key + i) & (limiter_slots - 1)];
+        quint64 current = site.key.load(std::memory_order_acquire);
+        if(current == key)
+            return &site;
+        if(current != 0 && !isIdle(site, nowUs))
+            continue;
+        if(site.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)){
+            site.ready.store(false, std::memory_order_relaxed);
+            site.tat.store(0, std::memory_order_relaxed);
+            site.type.store(type, std::memory_order_relaxed);
+            site.functionId.store(functionId, std::memory_order_relaxed);
+            site.categoryId.store(categoryId, std::memory_order_relaxed);
+            site.file.store(context.file, std::memory_order_relaxed);
+            site.line.store(context.line, std::memory_order_relaxed);
+            site.ready.store(true, std::memory_order_release);
+            return &site;
+        }
+        if(current == key)
+            return &site;
+    }
+    return &overflowSite;
+}
+
+bool takeReport(Site& site, RateLimiter::Report& report)
+{
+    // описание общего ведра пустое и всегда готово
+    if(&site != &overflowSite && !site.ready.load(std::memory_order_acquire)) return false;
+    report.suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+    if(!report.suppressed) return false;
+    report.type = site.type.load(std::memory_order_relaxed);
+    report.functionId = site.functionId.load(std::memory_order_relaxed);
+    report.categoryId = site.categoryId.load(std::memory_order_relaxed);
+    report.file = site.file.load(std::memory_order_relaxed);
+    report.line = site.line.load(std::memory_order_relaxed);
+    return true;
+}
+
+} //namespace
+
+
+void RateLimiter::setLimit(int messagesPerSecond, int burst)
+{
+    if(messagesPerSecond <= 0){
+        emissionIntervalUs.store(0, std::memory_order_relaxed);
+        return;
+    }
+    qint64 interval = qMax<qint64>(1, 1000000 / messagesPerSecond);
+    burstToleranceUs.store(interval * (qMax(burst, 1) - 1), std::memory_order_relaxed);
+    emissionIntervalUs.store(interval, std::memory_order_relaxed);
+}
+
+bool RateLimiter::isEnabled()
+{
+    return emissionIntervalUs.load(std::memory_order_relaxed) != 0;
+}
+
+bool RateLimiter::allow(const QMessageLogContext &context, QtMsgType type, const QString &msg,
+                        quint32 functionId, quint32 categoryId, qint64 now, Report &report)
+{
+    report.suppressed = 0;
+    qint64 interval = emissionIntervalUs.load(std::memory_order_relaxed);
+    if(!interval || type == QtFatalMsg) return true;
+    qint64 tolerance = burstToleranceUs.load(std::memory_order_relaxed);
+
+    // GCRA: сообщение проходит, если теоретическое время прихода опережает now не больше чем на tolerance
+    qint64 nowUs = now * 1000;
+    Site* site = findSite(siteKey(context, type, msg), type, functionId, categoryId, context, nowUs);
+    qint64 tat = site->tat.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        qint64 start = qMax(tat, nowUs);
+        if(start - nowUs > tolerance){
+            site->suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if(site->tat.compare_exchange_weak(tat, start + interval, std::memory_order_relaxed))
+            break;
+    }
+    takeReport(*site, report);
+    return true;
+}
+
+QVector<RateLimiter::Report> RateLimiter::takeReports()
+{
+    QVector<Report> reports;
+    Report report;
+    for(Site& site : sites)
+        if(site.key.load(std::memory_order_relaxed) && takeReport(site, report))
+            reports.append(report);
+    if(takeReport(overflowSite, report))
+        reports.append(report);
+    return reports;
+}
+
+QString RateLimiter::reportMessage(const Report &report)
+{
+    QString source = FunctionTable::name(report.functionId);
+    if(report.file)
+        source += QString(" (%1:%2)").arg(QString::fromUtf8(report.file)).arg(report.line);
+    if(source.isEmpty())
+        source = "unknown source";
+    return QString("suppressed %1 similar messages from %2").arg(report.suppressed).arg(source);
+}
@@ -0,0 +1,69 @@
+#ifndef LOGGINGRATELIMIT_H
+#define LOGGINGRATELIMIT_H
+
+#include <QString>
+#include <QVector>
+#include <qlogging.h>
+
+
+namespace Logging {
+
+/*!
+ * \brief The RateLimiter class ограничение частоты сообщений для каждого места вызова.
+ *  Место вызова определяется по QMessageLogContext (file, line, function),
+ *  а если контекста нет (release сборка без QT_MESSAGELOGCONTEXT) - по типу и тексту сообщения.
+ *  Для каждого места работает token bucket (в форме GCRA: одна атомарная метка времени),
+ *  поэтому проверка выполняется без блокировок и до форматирования сообщения.
+ *  Таблица мест вызова фиксированного размера: ячейка затихшего места (ведро снова полное,
+ *  сводка выведена) отдается новому месту, а если свободных ячеек нет,
+ *  сообщение ограничивается общим ведром для всех таких мест.
+ *  Подавленные сообщения считаются и выводятся одной записью
+ *  "suppressed N similar messages from ..." (см. messageHandler).
+ */
+class RateLimiter
+{
+public:
+    /*!
+     * \brief The Report struct сведения о подавленных сообщениях одного места вызова
+     */
+    struct Report
+    {
+        quint32 suppressed;
+        QtMsgType type;
+        quint32 functionId;
+        quint32 categoryId;
+        const char* file;
+        int line;
+    };
+
+    /*!
+     * \brief setLimit messagesPerSecond - средняя частота, burst - сколько сообщений подряд
+     *  проходит без ограничения. messagesPerSecond <= 0 отключает ограничение.
+     */
+    static void setLimit(int messagesPerSecond, int burst);
+    static bool isEnabled();
+
+    /*!
+     * \brief allow проверяет, можно ли выводить сообщение (now - Time::now()).
+     *  Если перед этим сообщения места вызова подавлялись, их сводка возвращается в report
+     *  (report.suppressed > 0), и счетчик обнуляется.
+     */
+    static bool allow(const QMessageLogContext& context, QtMsgType type, const QString& msg,
+                      quint32 functionId, quint32 categoryId, qint64 now, Report& report);
+
+    /*!
+     * \brief takeReports забирает сводки подавленных сообщений всех мест вызова
+     *  (для мест, которые замолчали и сами сводку уже не выведут)
+     */
+    static QVector<Report> takeReports();
+
+    /*!
+     * \brief reportMessage текст записи о подавленных сообщениях
+     */
+    static QString reportMessage(const Report& report);
+};
+
+} //namespace Logging
+
+
+#endif // LOGGINGRATELIMIT_H
@@ -0,0 +1,140 @@
+#include "LoggingSinks.h"
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace Logging;
+
+const int max_buffer_size = 16 * 1024 * 1024; // при политике "по времени" буфер не растет бесконечно
+const int stream_block_size = 64 * 1024; // блочный буфер stdout, когда вывод перенаправлен в pipe/файл
+
+FileSink::FileSink()
+{
+    m_buffer.reserve(m_bufferSize);
+    m_lastFlush.start();
+}
+
+FileSink::~FileSink()
+{
+    flush();
+}
+
+bool FileSink::open(const QString &path)
+{
+    if(m_file.isOpen()){
+        flush();
+        m_file.close();
+    }
+    m_file.setFileName(path);
+    // собственный буфер QFile не нужен, буферизацией занимается FileSink
+    return m_file.open(QFile::Append | QFile::Text | QFile::Unbuffered);
+}
+
+void FileSink::setFlushPolicy(FileFlushPolicy policy, int bufferSize, int intervalMs)
+{
+    flush();
+    m_policy = policy;
+    m_bufferSize = qMax(bufferSize, 0);
+    m_intervalMs = qMax(intervalMs, 0);
+    m_buffer.reserve(qMin(m_bufferSize, max_buffer_size));
+}
+
+bool FileSink::write(const QByteArray &data, bool urgent)
+{
+    m_buffer.append(data);
+
+    bool bySize = m_policy == FlushBySize || m_policy == FlushBySizeOrTime;
+    bool byTime = m_policy == FlushByTime || m_policy == FlushBySizeOrTime;
+    if(urgent
+        || m_policy == FlushEveryLine
+        || m_buffer.size() >= max_buffer_size
+        || (bySize && m_buffer.size() >= m_bufferSize)
+        || (byTime && m_lastFlush.hasExpired(m_intervalMs)))
+        return flush();
+    return true;
+}
+
+bool FileSink::flush()
+{
+    m_lastFlush.restart();
+    if(m_buffer.isEmpty()) return true;
+    if(!m_file.isOpen()){
+        // писать некуда: строки отбрасываются, иначе буфер рос бы бесконечно
+        m_buffer.resize(0);
+        return false;
+    }
+
+    qint64 written = m_file.write(m_buffer);
+    m_buffer.resize(0); // сохраняет зарезервированную память
+    return written >= 0 && m_file.error() == QFile::NoError;
+}
+
+
+
+StreamSink::StreamSink(OutputStream stream)
+{
+    setStream(stream);
+}
+
+StreamSink::~StreamSink()
+{
+    flush();
+}
+
+void StreamSink::setStream(OutputStream stream)
+{
+    flush();
+#ifdef Q_OS_WIN
+    m_fd = (stream == StandardError) ? _fileno(stderr) : _fileno(stdout);
+    m_terminal = _isatty(m_fd);
+#else
+    m_fd = (stream == StandardError) ? STDERR_FILENO : STDOUT_FILENO;
+    m_terminal = isatty(m_fd);
+#endif
+    if(!m_terminal)
+        m_buffer.reserve(stream_block_size);
+}
+
+bool StreamSink::write(const QByteArray &data, bool urgent)
+{
+    // в терминал выводим сразу всей пачкой, без копирования в буфер
+    if(m_terminal && m_buffer.isEmpty())
+        return writeAll(data.constData(), data.size());
+
+    m_buffer.append(data);
+    if(m_terminal || urgent || m_buffer.size() >= stream_block_size)
+        return flush();
+    return true;
+}
+
+bool StreamSink::flush()
+{
+    if(m_buffer.isEmpty()) return true;
+    bool ok = writeAll(m_buffer.constData(), m_buffer.size());
+    m_buffer.resize(0);
+    return ok;
+}
+
+bool StreamSink::writeAll(const char *data, qint64 size)
+{
+    while(size > 0)
+    {
+#ifdef Q_OS_WIN
+        int n = _write(m_fd, data, (unsigned int)qMin<qint64>(size, INT_MAX));
+#else
+        ssize_t n = ::write(m_fd, data, (size_t)size);
+#endif
+        if(n < 0){
+            if(errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
@@ -0,0 +1,98 @@
+#ifndef LOGGINGSINKS_H
+#define LOGGINGSINKS_H
+
+#include "Logging.h"
+#include "qelapsedtimer.h"
+#include "qfile.h"
+
+
+namespace Logging {
+
+/*!
+ * \brief The FileSink class приемник логов в файл.
+ *  Держит постоянный буфер уже закодированных в UTF-8 строк и сбрасывает его в файл
+ *  по политике FileFlushPolicy. Не потокобезопасен: вызывается под мьютексом Logging.cpp
+ */
+class FileSink
+{
+public:
+    FileSink();
+    ~FileSink();
+
+    /*!
+     * \brief open открывает файл на дозапись (предыдущий файл закрывается со сбросом буфера)
+     */
+    bool open(const QString& path);
+    bool isOpen() const { return m_file.isOpen(); }
+    QString fileName() const { return m_file.fileName(); }
+
+    void setFlushPolicy(FileFlushPolicy policy, int bufferSize, int intervalMs);
+    FileFlushPolicy flushPolicy() const { return m_policy; }
+    int flushInterval() const { return m_intervalMs; }
+
+    /*!
+     * \brief write добавляет строки в буфер и сбрасывает его, если этого требует политика.
+     *  urgent - сбросить сразу (QtCriticalMsg/QtFatalMsg)
+     */
+    bool write(const QByteArray& data, bool urgent);
+    /*!
+     * \brief flush записывает буфер в файл. Если файл не открыт, буфер отбрасывается
+     *  и возвращается false
+     */
+    bool flush();
+    /*!
+     * \brief hasPendingData в буфере есть не записанные в файл данные
+     */
+    bool hasPendingData() const { return !m_buffer.isEmpty(); }
+
+    QString errorString() const { return m_file.errorString(); }
+
+private:
+    QFile m_file;
+    QByteArray m_buffer;
+    FileFlushPolicy m_policy = FlushEveryLine;
+    int m_bufferSize = 64 * 1024;
+    int m_intervalMs = 1000;
+    QElapsedTimer m_lastFlush;
+};
+
+/*!
+ * \brief The StreamSink class приемник логов в stdout/stderr.
+ *  Пишет уже закодированные в UTF-8 строки напрямую в файловый дескриптор (write(2)),
+ *  минуя QTextStream и кодек локали: один системный вызов на пачку сообщений.
+ *  Если дескриптор - терминал, пачка выводится сразу (построчная буферизация),
+ *  если pipe или файл - данные копятся в блочном буфере.
+ *  Не потокобезопасен: вызывается под мьютексом Logging.cpp
+ */
+class StreamSink
+{
+public:
+    explicit StreamSink(OutputStream stream = StandardOutput);
+    ~StreamSink();
+
+    void setStream(OutputStream stream);
+    bool isTerminal() const { return m_terminal; }
+
+    /*!
+     * \brief write выводит строки или добавляет их в блочный буфер.
+     *  urgent - вывести сразу (QtCriticalMsg/QtFatalMsg)
+     */
+    bool write(const QByteArray& data, bool urgent);
+    /*!
+     * \brief flush выводит содержимое блочного буфера
+     */
+    bool flush();
+    bool hasPendingData() const { return !m_buffer.isEmpty(); }
+
+private:
+    bool writeAll(const char* data, qint64 size);
+
+    int m_fd = 1;
+    bool m_terminal = false;
+    QByteArray m_buffer;
+};
+
+} //namespace Logging
+
+
+#endif // LOGGINGSINKS_H
@@ -0,0 +1,269 @@
+#include "LoggingSymbols.h"
+#include "qhash.h"
+#include "qmutex.h"
+#include <atomic>
+
+using namespace Logging;
+
+namespace {
+
+const int segment_bits = 10;
+const quint32 segment_size = 1u << segment_bits; // записей в одном сегменте
+const quint32 segments_num = 4096;               // максимум segment_size * segments_num записей
+
+const quint32 call_site_slots = 4096; // размер кеша мест вызова (степень двойки)
+const quint32 call_site_probes = 16;  // длина поиска в кеше
+
+/*!
+ * \brief The InternTable struct хранилище уникальных имен с постоянными id.
+ *  Сегменты выделяются один раз и не перемещаются, поэтому читать записи
+ *  можно без блокировок, а мьютекс нужен только для добавления.
+ */
+template<typename Entry>
+struct InternTable
+{
+    std::atomic<Entry*> segments[segments_num] = {};
+    std::atomic<quint32> count = 0;
+    QMutex mutex;
+    QHash<QString, quint32> ids;
+
+    explicit InternTable(const QString& firstName){
+        // id 0 - запись по умолчанию
+        segments[0] = new Entry[segment_size];
+        segments[0].load()[0].name = firstName;
+        ids.insert(firstName, 0);
+        count = 1;
+    }
+
+    template<typename Init>
+    quint32 intern(const QString& name, Init init){
+        QMutexLocker locker(&mutex);
+        auto it = ids.constFind(name);
+        if(it != ids.constEnd())
+            return it.value();
+
+        quint32 id = count.load(std::memory_order_relaxed);
+        quint32 segment = id >> segment_bits;
+        if(segment >= segments_num) return 0;
+        if(!segments[segment].load(std::memory_order_relaxed))
+            segments[segment].store(new Entry[segment_size], std::memory_order_release);
+        Entry& entry = segments[segment].load(std::memory_order_relaxed)[id & (segment_size - 1)];
+        entry.name = name;
+        init(entry);
+        ids.insert(name, id);
+        count.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    quint32 intern(const QString& name){
+        return intern(name, [](Entry&){});
+    }
+
+    Entry& at(quint32 id){
+        if(id >= count.load(std::memory_order_acquire))
+            id = 0;
+        return segments[id >> segment_bits].load(std::memory_order_acquire)[id & (segment_size - 1)];
+    }
+};
+
+/*!
+ * \brief The CallSiteCache struct кеш "указатель на литерал -> значение" на атомиках
+ *  с открытой адресацией. Запись в ячейку выполняется один раз.
+ *  Значение - ненулевое число (id + 1) или указатель
+ */
+struct CallSiteCache
+{
+    struct Slot
+    {
+        std::atomic<const char*> key = nullptr;
+        std::atomic<quintptr> value = 0; // 0 - значение еще не записано
+    };
+    Slot slots[call_site_slots];
+
+    static inline quint32 pointerHash(const void* p)
+    {
+        quint64 v = (quint64)(quintptr)p;
+        v ^= v >> 33;
+        v *= 0xff51afd7ed558ccdULL;
+        v ^= v >> 33;
+        return (quint32)v;
+    }
+
+    template<typename Resolve>
+    quintptr lookup(const char* key, Resolve resolve)
+    {
+        quint32 h = pointerHash(key);
+        for(quint32 i = 0; i < call_site_probes; i++)
+        {
+            Slot& slot = slots[(h + i) & (call_site_slots - 1)];
+            const char* current = slot.key.load(std::memory_order_acquire);
+            if(current == key){
+                quintptr value = slot.value.load(std::memory_order_acquire);
+                if(value) return value;
+                break; // другой поток еще записывает значение
+            }
+            if(current == nullptr){
+                // первый вызов из этого места: вычисляем значение и занимаем ячейку
+                quintptr value = resolve(key);
+                if(slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+                    slot.value.store(value, std::memory_order_release);
+                return value;
+            }
+        }
+        // кеш переполнен - медленный путь
+        return resolve(key);
+    }
+};
+
+
+struct FunctionEntry
+{
+    QString name;
+    QStringList components;
+};
+
+struct CategoryEntry
+{
+    QString name;
+    std::atomic<quint8> mask = LevelMaskAll;
+};
+
+InternTable<FunctionEntry>& functions()
+{
+    static InternTable<FunctionEntry> instance{QString()};
+    return instance;
+}
+
+CallSiteCache& functionSites()
+{
+    static CallSiteCache instance;
+    return instance;
+}
+
+std::atomic<quint8> defaultCategoryMask = LevelMaskAll;
+
+InternTable<CategoryEntry>& categories()
+{
+    static InternTable<CategoryEntry> instance{QStringLiteral("default")};
+    return instance;
+}
+
+CallSiteCache& categorySites()
+{
+    static CallSiteCache instance;
+    return instance;
+}
+
+/*!
+ * \brief newCategorySite создает место вызова для указателя на имя категории.
+ *  Вызывается на медленном пути (первый вызов или переполнение кеша),
+ *  одинаковые указатели получают одно и то же место
+ */
+const CategoryTable::CallSite* newCategorySite(const char* category)
+{
+    static QMutex mutex;
+    static QHash<const char*, const CategoryTable::CallSite*> sites;
+    quint32 id = category ? CategoryTable::intern(QString::fromLatin1(category)) : 0;
+    QMutexLocker locker(&mutex);
+    const CategoryTable::CallSite*& site = sites[category];
+    if(!site)
+        site = new CategoryTable::CallSite{category, id, &categories().at(id).mask};
+    return site;
+}
+
+} //namespace
+
+std::atomic<const CategoryTable::CallSite*> CategoryTable::callSites[CategoryTable::call_sites_size] = {};
+
+
+quint32 FunctionTable::idForCallSite(const char *function)
+{
+    if(!function) return 0;
+    return quint32(functionSites().lookup(function, [](const char* f){
+        return quintptr(intern(parseName(f))) + 1;
+    }) - 1);
+}
+
+quint32 FunctionTable::intern(const QString &name)
+{
+    return functions().intern(name, [](FunctionEntry& entry){
+        entry.components = entry.name.split("::");
+    });
+}
+
+const QString &FunctionTable::name(quint32 id)
+{
+    return functions().at(id).name;
+}
+
+const QStringList &FunctionTable::components(quint32 id)
+{
+    return functions().at(id).components;
+}
+
+quint32 FunctionTable::count()
+{
+    return functions().count.load(std::memory_order_acquire);
+}
+
+QString FunctionTable::parseName(const char *function)
+{
+    // Ищем подстроку, которая начинается с последнего пробела
+    QString func = function;
+    int lastIndex = func.lastIndexOf('(');
+    func = func.left(lastIndex).trimmed();
+
+    int firstIndex = func.lastIndexOf(' ');
+    func = func.mid(firstIndex+1);
+    return func;
+}
+
+
+
+quint32 CategoryTable::idForCallSite(const char *category)
+{
+    return callSite(category)->id;
+}
+
+const CategoryTable::CallSite *CategoryTable::resolveCallSite(const char *category)
+{
+    const CallSite* site = category
+            ? (const CallSite*)categorySites().lookup(category, [](const char* c){ return quintptr(newCategorySite(c)); })
+            : newCategorySite(nullptr);
+    // ячейку занимает последнее место вызова с этим адресом
+    callSites[callSiteSlot(category)].store(site, std::memory_order_release);
+    return site;
+}
+
+quint32 CategoryTable::intern(const QString &name)
+{
+    if(name.isEmpty()) return 0;
+    return categories().intern(name, [](CategoryEntry& entry){
+        entry.mask.store(defaultCategoryMask.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    });
+}
+
+const QString &CategoryTable::name(quint32 id)
+{
+    return categories().at(id).name;
+}
+
+quint32 CategoryTable::count()
+{
+    return categories().count.load(std::memory_order_acquire);
+}
+
+quint8 CategoryTable::mask(quint32 id)
+{
+    return categories().at(id).mask.load(std::memory_order_relaxed);
+}
+
+void CategoryTable::setMask(quint32 id, quint8 mask)
+{
+    categories().at(id).mask.store(mask & LevelMaskAll, std::memory_order_relaxed);
+}
+
+void CategoryTable::setDefaultMask(quint8 mask)
+{
+    defaultCategoryMask.store(mask & LevelMaskAll, std::memory_order_relaxed);
+}
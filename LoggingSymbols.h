@@ -0,0 +1,131 @@
+#ifndef LOGGINGSYMBOLS_H
+#define LOGGINGSYMBOLS_H
+
+#include <QString>
+#include <QStringList>
+#include <qlogging.h>
+#include <atomic>
+
+
+namespace Logging {
+
+/*!
+ *  Маска уровней логирования: бит (1 << QtMsgType) разрешает сообщения этого уровня
+ */
+const quint8 LevelMaskAll = 0x1F;
+inline quint8 levelBit(QtMsgType type){ return quint8(1u << type); }
+
+/*!
+ * \brief The FunctionTable class глобальная таблица имен функций.
+ *  Каждое разобранное имя ("ns::Class::method") хранится один раз и получает
+ *  постоянный целочисленный id. Id 0 зарезервирован под пустое имя.
+ *  Вместе с именем хранятся его части ("ns", "Class", "method"), чтобы фильтр
+ *  функций и древо FunctionSelectorWidget не разбивали строку заново.
+ *
+ *  idForCallSite(..) кеширует результат по указателю QMessageLogContext::function.
+ *  Указатель ссылается на строковый литерал Q_FUNC_INFO, поэтому сигнатура
+ *  разбирается только при первом вызове из данного места,
+ *  дальше поиск идет без блокировок и выделения памяти.
+ */
+class FunctionTable
+{
+public:
+    /*!
+     * \brief idForCallSite возвращает id функции по сигнатуре из QMessageLogContext
+     */
+    static quint32 idForCallSite(const char* function);
+    /*!
+     * \brief intern возвращает id для уже разобранного имени функции, при необходимости добавляя его
+     */
+    static quint32 intern(const QString& name);
+    /*!
+     * \brief name возвращает имя функции по id. Можно вызывать из любых потоков.
+     */
+    static const QString& name(quint32 id);
+    /*!
+     * \brief components части имени, разделенные "::"
+     */
+    static const QStringList& components(quint32 id);
+    /*!
+     * \brief count количество зарегистрированных имен (включая пустое с id 0)
+     */
+    static quint32 count();
+
+    /*!
+     * \brief parseName выделяет имя функции из сигнатуры Q_FUNC_INFO
+     *  "void ns::Class::method(int)" -> "ns::Class::method"
+     */
+    static QString parseName(const char* function);
+};
+
+/*!
+ * \brief The CategoryTable class глобальная таблица категорий QLoggingCategory.
+ *  Каждая категория получает постоянный id (0 - категория "default")
+ *  и атомарную маску разрешенных уровней, которую messageHandler проверяет
+ *  до любой другой работы. Маску можно менять во время работы из любого потока.
+ *
+ *  Место вызова (указатель QMessageLogContext::category) хранит указатель на маску
+ *  своей категории. callSite(..) находит его по адресу имени в таблице прямого
+ *  отображения без хеширования, поэтому выключенная категория отсекается
+ *  загрузкой ячейки и маски. При промахе (первый вызов или две категории
+ *  в одной ячейке) место ищется в кеше по указателю, как и имена функций.
+ */
+class CategoryTable
+{
+public:
+    /*!
+     * \brief The CallSite struct место вызова: имя категории из QMessageLogContext,
+     *  ее id и маска. Создается один раз на указатель и не меняется
+     */
+    struct CallSite
+    {
+        const char* key;
+        quint32 id;
+        const std::atomic<quint8>* mask;
+    };
+
+    /*!
+     * \brief callSite место вызова по QMessageLogContext::category
+     */
+    static const CallSite* callSite(const char* category)
+    {
+        const CallSite* site = callSites[callSiteSlot(category)].load(std::memory_order_acquire);
+        return site && site->key == category ? site : resolveCallSite(category);
+    }
+    static bool isEnabled(const CallSite* site, QtMsgType type){
+        return site->mask->load(std::memory_order_relaxed) & levelBit(type);
+    }
+    /*!
+     * \brief idForCallSite возвращает id категории по QMessageLogContext::category
+     */
+    static quint32 idForCallSite(const char* category);
+    static quint32 intern(const QString& name);
+    static const QString& name(quint32 id);
+    static quint32 count();
+
+    /*!
+     * \brief mask маска разрешенных уровней категории
+     */
+    static quint8 mask(quint32 id);
+    static void setMask(quint32 id, quint8 mask);
+    static bool isEnabled(quint32 id, QtMsgType type){ return mask(id) & levelBit(type); }
+    /*!
+     * \brief setDefaultMask маска для категорий, которые еще не встречались
+     */
+    static void setDefaultMask(quint8 mask);
+
+private:
+    static const quint32 call_sites_size = 512; // ячеек таблицы мест вызова (степень двойки)
+    static std::atomic<const CallSite*> callSites[call_sites_size];
+
+    static quint32 callSiteSlot(const char* category){
+        // литералы выровнены слабо, младшие биты адреса отбрасываются
+        return quint32(quintptr(category) >> 3) & (call_sites_size - 1);
+    }
+    static const CallSite* resolveCallSite(const char* category);
+};
+
+} //namespace Logging
+
+
+#endif // LOGGINGSYMBOLS_H
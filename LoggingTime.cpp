@@ -0,0 +1,168 @@
+#include "LoggingTime.h"
+#include "qdatetime.h"
+#include <atomic>
+#include <chrono>
+
+using namespace Logging;
+
+const qint64 msecs_per_day = 86400000;
+const qint64 resync_interval_ms = 1000; // как часто пересчитывать смещение монотонных часов
+const qint64 max_slew_ms = 100;         // на сколько смещение может уменьшиться за один пересчет
+const qint64 clock_step_ms = 2000;      // коррекция назад больше - скачок часов, применяется сразу:
+                                        // плавно она длилась бы clock_step_ms / max_slew_ms пересчетов
+
+static inline qint64 floorDiv(qint64 a, qint64 b)
+{
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+static inline qint64 monotonicMs()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/*!
+ * \brief wallClockMs текущее локальное время через QDateTime (медленно, с переводом часового пояса)
+ */
+static qint64 wallClockMs()
+{
+    QDateTime now = QDateTime::currentDateTime();
+    return now.toMSecsSinceEpoch() + (qint64)now.offsetFromUtc() * 1000;
+}
+
+qint64 Time::now()
+{
+    // смещение = настенное время - монотонное
+    static std::atomic<qint64> offset = wallClockMs() - monotonicMs();
+    static std::atomic<qint64> nextSync = monotonicMs() + resync_interval_ms;
+    static std::atomic<qint64> last = 0; // последнее выданное время
+
+    qint64 mono = monotonicMs();
+    qint64 sync = nextSync.load(std::memory_order_relaxed);
+    // пересчитывает только один поток, остальные используют старое смещение
+    if(mono >= sync && nextSync.compare_exchange_strong(sync, mono + resync_interval_ms))
+    {
+        qint64 current = offset.load(std::memory_order_relaxed);
+        qint64 target = wallClockMs() - mono;
+        // коррекция назад растягивается на несколько пересчетов, вперед применяется сразу
+        if(target < current && current - target < clock_step_ms)
+            target = qMax(target, current - max_slew_ms);
+        offset.store(target, std::memory_order_relaxed);
+    }
+    qint64 value = mono + offset.load(std::memory_order_relaxed);
+
+    // время не идет назад ни между потоками, ни при уменьшении смещения:
+    // метки остаются упорядоченными для двоичного поиска по истории
+    qint64 prev = last.load(std::memory_order_relaxed);
+    while(value > prev && !last.compare_exchange_weak(prev, value, std::memory_order_relaxed));
+    if(value >= prev) return value;
+    // часы переведены назад - отсчет продолжается от нового времени
+    if(prev - value >= clock_step_ms){
+        last.store(value, std::memory_order_relaxed);
+        return value;
+    }
+    return prev;
+}
+
+qint64 Time::daysFromCivil(int y, int m, int d)
+{
+    y -= m <= 2;
+    const qint64 era = (y >= 0 ? y : y - 399) / 400;
+    const qint64 yoe = y - era * 400;
+    const qint64 doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const qint64 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void Time::civilFromDays(qint64 z, int &year, int &month, int &day)
+{
+    z += 719468;
+    const qint64 era = (z >= 0 ? z : z - 146096) / 146097;
+    const qint64 doe = z - era * 146097;
+    const qint64 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const qint64 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const qint64 mp = (5 * doy + 2) / 153;
+    day = (int)(doy - (153 * mp + 2) / 5 + 1);
+    month = (int)(mp < 10 ? mp + 3 : mp - 9);
+    year = (int)(yoe + era * 400 + (month <= 2));
+}
+
+qint64 Time::fromParts(int year, int month, int day, int hour, int minute, int second, int msec)
+{
+    return daysFromCivil(year, month, day) * msecs_per_day
+           + ((hour * 60 + minute) * 60 + second) * 1000LL + msec;
+}
+
+qint64 Time::fromDateTime(const QDateTime &dateTime)
+{
+    if(!dateTime.isValid()) return 0;
+    const QDate date = dateTime.date();
+    const QTime time = dateTime.time();
+    return fromParts(date.year(), date.month(), date.day(),
+                     time.hour(), time.minute(), time.second(), time.msec());
+}
+
+QDateTime Time::toDateTime(qint64 stamp)
+{
+    int y, m, d;
+    qint64 days = floorDiv(stamp, msecs_per_day);
+    int msOfDay = (int)(stamp - days * msecs_per_day);
+    civilFromDays(days, y, m, d);
+    return QDateTime(QDate(y, m, d), QTime::fromMSecsSinceStartOfDay(msOfDay));
+}
+
+
+static inline void writeDigits(QChar* out, int value, int digits)
+{
+    for(int i = digits - 1; i >= 0; i--){
+        out[i] = QChar(ushort('0' + value % 10));
+        value /= 10;
+    }
+}
+
+void TimestampFormatter::update(qint64 stamp)
+{
+    qint64 second = floorDiv(stamp, 1000);
+    if(!m_valid || second != m_second)
+    {
+        // новая секунда - пересобираем префикс "yyyy-MM-dd hh:mm:ss"
+        m_second = second;
+        m_valid = true;
+        qint64 days = floorDiv(second, 86400);
+        int secOfDay = (int)(second - days * 86400);
+        int y, m, d;
+        Time::civilFromDays(days, y, m, d);
+        writeDigits(m_text, y, 4);
+        m_text[4] = '-';
+        writeDigits(m_text + 5, m, 2);
+        m_text[7] = '-';
+        writeDigits(m_text + 8, d, 2);
+        m_text[10] = ' ';
+        writeDigits(m_text + 11, secOfDay / 3600, 2);
+        m_text[13] = ':';
+        writeDigits(m_text + 14, secOfDay / 60 % 60, 2);
+        m_text[16] = ':';
+        writeDigits(m_text + 17, secOfDay % 60, 2);
+        m_text[19] = '.';
+    }
+    writeDigits(m_text + 20, (int)(stamp - second * 1000), 3);
+}
+
+QString TimestampFormatter::format(qint64 stamp)
+{
+    update(stamp);
+    return QString(m_text, text_size);
+}
+
+void TimestampFormatter::appendDate(QString &out, qint64 stamp)
+{
+    update(stamp);
+    out.append(m_text, 10);
+}
+
+void TimestampFormatter::appendTime(QString &out, qint64 stamp, bool withMs)
+{
+    update(stamp);
+    out.append(m_text + 11, withMs ? 12 : 8);
+}
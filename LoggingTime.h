@@ -0,0 +1,85 @@
+#ifndef LOGGINGTIME_H
+#define LOGGINGTIME_H
+
+#include <QString>
+class QDateTime;
+
+
+namespace Logging {
+
+/*!
+ *  Время сообщений хранится как qint64 - миллисекунды локального (настенного) времени
+ *  от 1970-01-01 00:00:00.000. Часовой пояс уже учтен, поэтому перевод в дату/время
+ *  и обратно выполняется арифметикой, без QDateTime и преобразований часовых поясов.
+ */
+namespace Time {
+
+/*!
+ * \brief now возвращает текущее локальное время.
+ *  Основано на монотонных часах и смещении до настенного времени,
+ *  которое пересчитывается не чаще раза в секунду. Время не убывает: небольшие коррекции
+ *  часов назад (NTP, меньше 2 с) применяются постепенно, не больше 100 мс за пересчет -
+ *  метки отстают не дольше 20 с. Больший скачок назад (летнее время, ручная установка)
+ *  применяется сразу, отсчет продолжается от нового времени.
+ */
+qint64 now();
+/*!
+ * \brief fromParts собирает метку времени из даты и времени
+ */
+qint64 fromParts(int year, int month, int day, int hour = 0, int minute = 0, int second = 0, int msec = 0);
+/*!
+ * \brief fromDateTime переводит QDateTime в метку времени (невалидная дата -> 0)
+ */
+qint64 fromDateTime(const QDateTime& dateTime);
+/*!
+ * \brief toDateTime переводит метку времени в локальный QDateTime
+ */
+QDateTime toDateTime(qint64 stamp);
+
+/*!
+ * \brief daysFromCivil номер дня от 1970-01-01 по дате григорианского календаря
+ */
+qint64 daysFromCivil(int year, int month, int day);
+/*!
+ * \brief civilFromDays дата григорианского календаря по номеру дня от 1970-01-01
+ */
+void civilFromDays(qint64 days, int& year, int& month, int& day);
+
+} //namespace Time
+
+
+/*!
+ * \brief The TimestampFormatter class быстрое форматирование меток времени
+ *  в "yyyy-MM-dd hh:mm:ss.zzz". Префикс "yyyy-MM-dd hh:mm:ss" кешируется
+ *  для текущей секунды, для остальных сообщений той же секунды дописываются только миллисекунды.
+ *  Не потокобезопасен: каждому потоку/форматеру нужен свой экземпляр.
+ */
+class TimestampFormatter
+{
+public:
+    /*!
+     * \brief format возвращает строку "yyyy-MM-dd hh:mm:ss.zzz"
+     */
+    QString format(qint64 stamp);
+    /*!
+     * \brief appendDate дописывает "yyyy-MM-dd"
+     */
+    void appendDate(QString& out, qint64 stamp);
+    /*!
+     * \brief appendTime дописывает "hh:mm:ss" или "hh:mm:ss.zzz"
+     */
+    void appendTime(QString& out, qint64 stamp, bool withMs);
+
+private:
+    void update(qint64 stamp);
+
+    static const int text_size = 23;
+    qint64 m_second = -1;
+    bool m_valid = false;
+    QChar m_text[text_size];
+};
+
+} //namespace Logging
+
+
+#endif // LOGGINGTIME_H
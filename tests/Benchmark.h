@@ -0,0 +1,46 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "qelapsedtimer.h"
+#include "qglobal.h"
+
+
+namespace Logging {
+namespace Benchmark {
+
+const int default_repeats = 5;
+
+/*!
+ * \brief bestSeconds лучшее время run() из repeats запусков, в секундах.
+ *  Лучшее, а не среднее: меньше зависит от планировщика и соседних процессов
+ */
+template<typename Run>
+double bestSeconds(Run run, int repeats = default_repeats)
+{
+    double best = 0;
+    for(int i = 0; i < repeats; i++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        double seconds = timer.nsecsElapsed() / 1e9;
+        if(!i || seconds < best)
+            best = seconds;
+    }
+    return best;
+}
+
+/*!
+ * \brief keep не дает оптимизатору выбросить вычисление value
+ */
+inline void keep(qint64 value)
+{
+    static volatile qint64 sink;
+    sink = value;
+}
+
+} //namespace Benchmark
+} //namespace Logging
+
+
+#endif // BENCHMARK_H
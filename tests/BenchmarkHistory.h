@@ -0,0 +1,101 @@
+#ifndef BENCHMARKHISTORY_H
+#define BENCHMARKHISTORY_H
+
+#include "LogConsoleWidget.h"
+#include "LogHistory.h"
+#include <cstring>
+
+
+namespace Logging {
+namespace Benchmark {
+
+/*!
+ * \brief consoleSettings настройки консоли для замеров: все поля и уровни, расширенная раскраска
+ */
+inline ConsoleSettings consoleSettings()
+{
+    ConsoleSettings settings;
+    settings.dispField.date = true;
+    settings.dispField.time = true;
+    settings.dispField.timeMs = true;
+    settings.dispField.logLevel = true;
+    settings.dispField.messageSource = true;
+    settings.dispField.category = true;
+    settings.enableLogMsgs.warningMsg = true;
+    settings.enableLogMsgs.debugMsg = true;
+    settings.enableLogMsgs.infoMsg = true;
+    settings.enableLogMsgs.criticalMsg = true;
+    settings.enableLogMsgs.fatalMsg = true;
+    settings.colors.date = settings.colors.time = QColor(0x00, 0x88, 0xcc);
+    settings.colors.logLevel = QColor(0xff, 0xaa, 0);
+    settings.colors.messageSource = QColor(0x00, 0xaa, 0xff);
+    settings.colors.infoMessage = settings.colors.debugMessage = QColor(0, 0xe6, 0x73);
+    settings.colors.warningMessage = QColor(0xff, 0xaa, 0);
+    settings.colors.criticalMessage = settings.colors.fatalMessage = Qt::white;
+    settings.colors.criticalMessageBg = settings.colors.fatalMessageBg = Qt::red;
+    settings.extendedColors = true;
+    settings.restoreWindowPosSize = false;
+    settings.textFormat.setFontFamily("Consolas");
+    settings.textFormat.setFontPointSize(11);
+    settings.historyMaxLines = 0;
+    settings.historyMaxMegabytes = 0;
+    settings.timeFilter = ConsoleSettings::TimeFilterOff;
+    settings.filterStartTime = settings.filterEndTime = 0;
+    settings.filterLastMinutes = 10;
+    return settings;
+}
+
+/*!
+ * \brief historyBatch пачка строк истории без разбора текста: время, уровни, функции и сообщения по кругу
+ */
+inline LogHistory::Batch historyBatch(int count, qint64 firstTimestamp)
+{
+    static const char* const messages[] = {
+        "connection established",
+        "value = [1, 2, 3]",
+        "a fairly long message that wraps around the console width and keeps going for a while "
+        "to look like a stack trace, long enough to need more than one line when wrapping is on"
+    };
+    quint32 functions[] = {FunctionTable::intern("main"), FunctionTable::intern("ns::Class::method"),
+                           FunctionTable::intern("MainWindow::onTimer")};
+    LogHistory::Batch batch;
+    batch.lines.reserve(count);
+    for(int i = 0; i < count; i++)
+    {
+        const char* message = messages[i % 3];
+        LogHistory::Batch::Line line;
+        line.timestamp = firstTimestamp + i * 7;
+        line.functionId = functions[i % 3];
+        line.categoryId = 0;
+        line.textOffset = quint32(batch.text.size());
+        line.textSize = quint32(strlen(message));
+        line.type = quint8(i % 5);
+        line.flags = 0;
+        batch.text.append(message, int(line.textSize));
+        batch.lines.append(line);
+    }
+    batch.functions = QVector<quint32>(functions, functions + 3);
+    return batch;
+}
+
+/*!
+ * \brief fillHistory история из total строк historyBatch(..) без ограничений
+ *  и список всех ее строк для отображения
+ */
+inline QVector<qint64> fillHistory(LogHistory& history, int total)
+{
+    const int batch_lines = 1000000;
+    history.setLimits(0, 0);
+    for(int added = 0; added < total; added += batch_lines)
+        history.append(historyBatch(qMin(batch_lines, total - added), added * 7LL));
+    QVector<qint64> rows(history.size());
+    for(int i = 0; i < rows.size(); i++)
+        rows[i] = history.firstIndex() + i;
+    return rows;
+}
+
+} //namespace Benchmark
+} //namespace Logging
+
+
+#endif // BENCHMARKHISTORY_H
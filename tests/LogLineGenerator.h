@@ -0,0 +1,148 @@
+#ifndef LOGLINEGENERATOR_H
+#define LOGLINEGENERATOR_H
+
+#include "Logging.h"
+#include "LoggingTime.h"
+#include "qbytearray.h"
+#include "qstringlist.h"
+#include <random>
+
+
+namespace Logging {
+
+/*!
+ * \brief The LogLineGenerator class строки файла логов для тестов и замеров.
+ *  Случайные, но воспроизводимые (seed). Время идет вперед с переходами через сутки
+ *  и редкими откатами назад (несколько потоков, склеенные файлы), уровни - все,
+ *  функции и категории - из небольших наборов, в том числе не ASCII.
+ *  malformedHeader() дает заголовки другого вида: без полей, с лишними пробелами,
+ *  с неполными датой и временем, с неизвестным уровнем.
+ */
+class LogLineGenerator
+{
+public:
+    explicit LogLineGenerator(quint32 seed = 1) : m_random(seed) {}
+
+    /*!
+     * \brief header заголовок в формате LogLine::toQString (часть до " >> ")
+     */
+    QByteArray header()
+    {
+        advanceTime();
+        QByteArray header = m_formatter.format(m_time).toLatin1();
+        header += ' ';
+        header += level();
+        header += ' ';
+        header += pick(functions()).toUtf8();
+        if(uniform(0, 3) == 0){
+            header += " [";
+            header += pick(categories()).toUtf8();
+            header += ']';
+        }
+        return header;
+    }
+
+    /*!
+     * \brief malformedHeader заголовок, отличающийся от формата LogLine::toQString
+     */
+    QByteArray malformedHeader()
+    {
+        QByteArray valid = header();
+        QByteArray date = valid.left(10);
+        QByteArray time = valid.mid(11, 12);
+        QByteArray rest = valid.mid(24);
+        switch(uniform(0, 15)){
+        case 0:  return date + ' ' + time.left(8) + ' ' + rest;            // без миллисекунд
+        case 1:  return date + "  " + time + ' ' + rest;                    // два пробела
+        case 2:  return date + ' ' + time + "   " + rest + "  ";            // пробелы вокруг полей
+        case 3:  return date + ' ' + time;                                  // только время
+        case 4:  return date + ' ' + time + ' ' + level();                  // без функции
+        case 5:  return date + ' ' + time + ' ' + level() + " [" + pick(categories()).toUtf8() + ']';
+        case 6:  return date + ' ' + time + ' ' + level() + " func []";     // пустая категория
+        case 7:  return date + ' ' + time + " TRACE " + rest.mid(rest.indexOf(' ') + 1);
+        case 8:  return date + ' ' + time + " info " + rest.mid(rest.indexOf(' ') + 1);
+        case 9:  return time + ' ' + rest;                                  // без даты
+        case 10: return QByteArray("2024-1-2 3:4:5.6 ") + rest;             // неполные поля
+        case 11: return QByteArray(date).replace('-', '/') + ' ' + time + ' ' + rest;
+        case 12: return date + '\t' + time + ' ' + rest;                    // табуляция
+        case 13: return date + ' ' + time + ' ' + level() + " ns::f extra words [cat]";
+        case 14: return date + ' ' + time + ' ' + level() + " Уровень::функция";
+        default: return pick(QStringList{"", "word", "two words", " 2024-01-02 10:00:00.000 INFO f"}).toUtf8();
+        }
+    }
+
+    /*!
+     * \brief line строка файла: заголовок (malformedPercent процентов - другого вида) и сообщение
+     */
+    QByteArray line(int malformedPercent = 0)
+    {
+        QByteArray line = uniform(0, 99) < malformedPercent ? malformedHeader() : header();
+        line += " >> ";
+        line += pick(messages()).toUtf8();
+        line += ' ';
+        line += QByteArray::number(uniform(0, 1000000));
+        return line;
+    }
+
+    /*!
+     * \brief file содержимое файла логов из count строк
+     */
+    QByteArray file(int count, int malformedPercent = 0)
+    {
+        QByteArray data;
+        data.reserve(count * 96);
+        for(int i = 0; i < count; i++){
+            data += line(malformedPercent);
+            data += '\n';
+        }
+        return data;
+    }
+
+private:
+    int uniform(int from, int to){ return std::uniform_int_distribution<int>(from, to)(m_random); }
+    QString pick(const QStringList& list){ return list.at(uniform(0, list.size() - 1)); }
+
+    void advanceTime()
+    {
+        switch(uniform(0, 99)){
+        case 0:  m_time += 86400000LL * uniform(1, 400); break;  // другой день, месяц, год
+        case 1:  m_time -= uniform(1, 5000); break;              // строка из другого потока
+        default: m_time += uniform(0, 250);
+        }
+    }
+
+    QByteArray level()
+    {
+        return msgTypeToString(QtMsgType(uniform(QtDebugMsg, QtInfoMsg))).toLatin1();
+    }
+
+    static const QStringList& functions()
+    {
+        static const QStringList list{"main", "MainWindow::onTimer", "ns::Class::method",
+                                      "Logging::LogConsoleWidget::loadLogsHistory", "Модуль::функция",
+                                      "(anonymous)", "<lambda>", "a"};
+        return list;
+    }
+    static const QStringList& categories()
+    {
+        static const QStringList list{"default", "app.network", "qt.core", "категория", "x"};
+        return list;
+    }
+    static const QStringList& messages()
+    {
+        static const QStringList list{"started", "connection refused: host unreachable",
+                                      "value = [1, 2, 3]", "строка >> со стрелкой", "",
+                                      "a fairly long message that wraps around the console width "
+                                      "and keeps going for a while to look like a stack trace"};
+        return list;
+    }
+
+    std::mt19937 m_random;
+    qint64 m_time = Time::fromParts(2023, 12, 30, 23, 59, 0);
+    TimestampFormatter m_formatter;
+};
+
+} //namespace Logging
+
+
+#endif // LOGLINEGENERATOR_H
@@ -0,0 +1,64 @@
+#include "Benchmark.h"
+#include "BenchmarkHistory.h"
+#include "LogLinesDisplayWidget.h"
+#include "qapplication.h"
+#include "qthread.h"
+#include "qthreadpool.h"
+#include <cstdio>
+
+using namespace Logging;
+
+const int plain_lines = 1000000; // копируются текстом
+const int rich_lines = 19000;    // меньше rich_copy_rows: копируются и с форматированием
+
+/*!
+ *  Замер копирования выделения LogLinesDisplayWidget при разном числе потоков
+ *  своего пула виджета (setThreadPool, в нем работают задачи форматирования): текст всей истории
+ *  (selectedText) и копирование с форматированием (copy). Ускорение - относительно одного потока
+ */
+void benchCopy(const char* name, int lines, bool rich, const QVector<int>& threads)
+{
+    ConsoleSettings settings = Benchmark::consoleSettings();
+    ConsoleFormatter formatter(&settings);
+    LogHistory history;
+    QVector<qint64> rows = Benchmark::fillHistory(history, lines);
+    QThreadPool pool;
+    LogLinesDisplayWidget view;
+    view.setSource(&history, &formatter);
+    view.setThreadPool(&pool);
+    view.appendRows(rows);
+    view.selectAll();
+
+    double single = 0;
+    for(int count : threads)
+    {
+        pool.setMaxThreadCount(count);
+        double seconds = Benchmark::bestSeconds([&](){
+            if(rich)
+                view.copy();
+            else
+                Benchmark::keep(view.selectedText().size());
+        }, 3);
+        if(count == 1)
+            single = seconds;
+        printf("%-22s %2d threads: %8.1f ms, speedup %.2fx\n", name, count, seconds * 1000, single / seconds);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    // 1, 2, 4, 8 потоков и все ядра машины
+    QVector<int> threads;
+    for(int count = 1; count < QThread::idealThreadCount() && count <= 8; count *= 2)
+        threads.append(count);
+    threads.append(QThread::idealThreadCount());
+    printf("cores: %d\n", QThread::idealThreadCount());
+
+    benchCopy("selectedText, 1M lines", plain_lines, false, threads);
+    benchCopy("copy (rich), 19k lines", rich_lines, true, threads);
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "Benchmark.h"
+#include "Logging.h"
+#include "qcoreapplication.h"
+#include "qfile.h"
+#include "qtemporarydir.h"
+#include "qtextstream.h"
+#include <cstdio>
+
+using namespace Logging;
+
+const int bench_messages = 200000;
+const int bench_repeats = 3;
+
+/*!
+ *  Замер записи в файл логов через messageHandler для каждой политики сброса (FileSink)
+ *  и для прежней записи: QTextStream на каждое сообщение, Qt::endl и flush().
+ *  Вывод в stdout отключен, файлы создаются во временном каталоге
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTemporaryDir dir;
+    if(!dir.isValid()){
+        fprintf(stderr, "no temporary directory\n");
+        return 1;
+    }
+    setEnableConsoleLogging(false);
+    setEnableFileEncoding(false);
+    setEnableFileLogging(true);
+
+    QMessageLogContext context("bench_fileflush.cpp", 1, "int main(int, char**)", "default");
+    QString message("value changed: 1234567");
+
+    // прежний путь: поток и сброс на каждое сообщение
+    QFile file(dir.filePath("old.log"));
+    file.open(QFile::WriteOnly | QFile::Append | QFile::Text);
+    double old = Benchmark::bestSeconds([&](){
+        for(int i = 0; i < bench_messages; i++){
+            QTextStream out(&file);
+            out << "2024-03-01 10:11:12.013 INFO main >> " << message << Qt::endl;
+            out.flush();
+        }
+    }, bench_repeats);
+    printf("%-40s %10.0f lines/s\n", "QTextStream + endl per message (old)", bench_messages / old);
+
+    const struct { FileFlushPolicy policy; const char* name; } policies[] = {
+        {FlushEveryLine, "FlushEveryLine"},
+        {FlushBySize, "FlushBySize (64 KiB)"},
+        {FlushByTime, "FlushByTime (1000 ms)"},
+        {FlushBySizeOrTime, "FlushBySizeOrTime (64 KiB, 1000 ms)"}
+    };
+    for(const auto& p : policies)
+    {
+        QString path = dir.filePath(QString(p.name).section(' ', 0, 0) + ".log");
+        QFile(path).open(QFile::WriteOnly);
+        setLoggingFile(path);
+        setFileFlushPolicy(p.policy, 64 * 1024, 1000);
+        double seconds = Benchmark::bestSeconds([&](){
+            for(int i = 0; i < bench_messages; i++)
+                messageHandler(QtInfoMsg, context, message);
+            flush();
+        }, bench_repeats);
+        printf("%-40s %10.0f lines/s\n", p.name, bench_messages / seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "Benchmark.h"
+#include "BenchmarkHistory.h"
+#include "qcoreapplication.h"
+#include <cstdio>
+
+using namespace Logging;
+
+const int bench_lines = 10000000;
+
+/*!
+ *  Замер фильтрации 10 млн строк истории по уровню (только warning, critical, fatal)
+ *  и диапазону времени (средняя половина истории): построчно через собранную запись
+ *  (LogHistory::record, как раньше по QVector<LogLine>) против прохода по колонкам
+ *  (ConsoleFormatter::appendVisibleRows), в том числе после сужения LogHistory::timeRange
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    LogHistory history;
+    Benchmark::fillHistory(history, bench_lines);
+    qint64 begin = history.firstIndex();
+    qint64 end = history.endIndex();
+
+    ConsoleSettings settings = Benchmark::consoleSettings();
+    settings.enableLogMsgs.debugMsg = false;
+    settings.enableLogMsgs.infoMsg = false;
+    settings.timeFilter = ConsoleSettings::TimeFilterRange;
+    qint64 firstTime = history.timestamp(begin);
+    qint64 lastTime = history.timestamp(end - 1);
+    settings.filterStartTime = firstTime + (lastTime - firstTime) / 4;
+    settings.filterEndTime = lastTime - (lastTime - firstTime) / 4;
+    ConsoleFormatter formatter(&settings);
+    qint64 timeFrom, timeTo;
+    formatter.timeWindow(timeFrom, timeTo);
+
+    QVector<qint64> rows;
+    rows.reserve(bench_lines);
+    double records = Benchmark::bestSeconds([&](){
+        rows.clear();
+        for(qint64 i = begin; i < end; i++){
+            LogHistory::Record record = history.record(i);
+            if(record.timestamp >= timeFrom && record.timestamp <= timeTo
+               && formatter.isLineVisible(QtMsgType(record.type), record.functionId, record.categoryId))
+                rows.append(i);
+        }
+    }, 3);
+    int expected = rows.size();
+
+    double columns = Benchmark::bestSeconds([&](){
+        rows.clear();
+        formatter.appendVisibleRows(history, begin, end, timeFrom, timeTo, rows);
+    }, 3);
+    if(rows.size() != expected){
+        fprintf(stderr, "column filter found %d rows, expected %d\n", rows.size(), expected);
+        return 1;
+    }
+
+    double narrowed = Benchmark::bestSeconds([&](){
+        rows.clear();
+        qint64 from = begin, to = end;
+        history.timeRange(timeFrom, timeTo, from, to);
+        formatter.appendVisibleRows(history, from, to, timeFrom, timeTo, rows);
+    }, 3);
+    if(rows.size() != expected){
+        fprintf(stderr, "narrowed filter found %d rows, expected %d\n", rows.size(), expected);
+        return 1;
+    }
+
+    printf("%d lines, %d pass the level and time filters\n", bench_lines, expected);
+    printf("row by row (record):        %8.1f ms, %6.0f Mlines/s\n", records * 1000, bench_lines / records / 1e6);
+    printf("columns (appendVisibleRows): %7.1f ms, %6.0f Mlines/s (%.1fx)\n",
+           columns * 1000, bench_lines / columns / 1e6, records / columns);
+    printf("columns after timeRange:    %8.1f ms, %6.0f Mlines/s (%.1fx)\n",
+           narrowed * 1000, bench_lines / narrowed / 1e6, records / narrowed);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "Benchmark.h"
+#include "BenchmarkHistory.h"
+#include "LogLinesDisplayWidget.h"
+#include "qapplication.h"
+#include "qscrollbar.h"
+#include <cstdio>
+
+using namespace Logging;
+
+const int bench_frames = 200;    // кадров на замер
+const int view_width = 1200;
+const int view_height = 800;
+
+/*!
+ *  Замер времени кадра LogLinesDisplayWidget при 10 тыс., 1 млн и 10 млн строк истории.
+ *  Каждый кадр прокручивает на страницу (раскладки строк не берутся из кеша)
+ *  и перерисовывается синхронно. Без дисплея используется платформа offscreen
+ */
+
+int main(int argc, char *argv[])
+{
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    ConsoleSettings settings = Benchmark::consoleSettings();
+    for(int total : {10000, 1000000, 10000000})
+    {
+        LogHistory history;
+        QVector<qint64> rows = Benchmark::fillHistory(history, total);
+
+        ConsoleFormatter formatter(&settings);
+        for(bool wrap : {false, true})
+        {
+            LogLinesDisplayWidget view;
+            view.setSource(&history, &formatter);
+            view.setTextFont(settings.textFormat.font());
+            view.setLineWrap(wrap);
+            view.resize(view_width, view_height);
+            view.show();
+            view.appendRows(rows);
+            QApplication::processEvents();
+
+            int page = qMax(1, view.verticalScrollBar()->pageStep());
+            int row = 0;
+            double seconds = Benchmark::bestSeconds([&](){
+                for(int frame = 0; frame < bench_frames; frame++)
+                {
+                    row = (row + page) % qMax(1, view.rowCount() - page);
+                    view.scrollToRow(row);
+                    view.viewport()->repaint();
+                }
+            }, 3);
+            printf("%9d lines, wrap %-3s: %.2f ms/frame\n", total, wrap ? "on" : "off",
+                   seconds * 1000 / bench_frames);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "Benchmark.h"
+#include "LogFileReader.h"
+#include "LogLineGenerator.h"
+#include "qcoreapplication.h"
+#include "qfile.h"
+#include "qtemporarydir.h"
+#include "qthread.h"
+#include "qthreadpool.h"
+#include <cstdio>
+
+using namespace Logging;
+
+const int bench_lines = 2000000;
+// деление файла на диапазоны - как в LogConsoleWidget::loadLogsHistory
+const qint64 load_range_min = 1024 * 1024;
+const qint64 load_range_max = 16 * 1024 * 1024;
+const int load_ranges_per_thread = 8;
+
+/*!
+ *  Замер разбора файла логов (LogFileReader::parseRanges) пулом из 1, 2, 4 ... потоков
+ *  до числа ядер машины. Выводит МБ/с, строки/с, ускорение относительно одного потока
+ *  и эффективность (ускорение на поток). Файл создается во временном каталоге
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTemporaryDir dir;
+    if(!dir.isValid()){
+        fprintf(stderr, "no temporary directory\n");
+        return 1;
+    }
+    QString path = dir.filePath("bench.log");
+    {
+        QFile file(path);
+        if(!file.open(QFile::WriteOnly) || file.write(LogLineGenerator().file(bench_lines)) < 0){
+            fprintf(stderr, "cannot write %s\n", qPrintable(path));
+            return 1;
+        }
+    }
+    QSharedPointer<LogFileReader> reader(new LogFileReader(path));
+    if(!reader->open()){
+        fprintf(stderr, "cannot open %s\n", qPrintable(path));
+        return 1;
+    }
+    double megabytes = reader->size() / (1024.0 * 1024.0);
+    printf("%d lines, %.0f MiB, cores: %d\n", bench_lines, megabytes, QThread::idealThreadCount());
+
+    QVector<int> threads;
+    for(int count = 1; count < QThread::idealThreadCount(); count *= 2)
+        threads.append(count);
+    threads.append(QThread::idealThreadCount());
+
+    double single = 0;
+    for(int count : threads)
+    {
+        QThreadPool pool;
+        pool.setMaxThreadCount(count);
+        qint64 rangeSize = qBound(load_range_min,
+                                  (reader->size() - reader->dataBegin()) / (count * load_ranges_per_thread),
+                                  load_range_max);
+        QVector<LogFileReader::Range> ranges = reader->splitRanges(reader->dataBegin(), reader->size(), rangeSize);
+        qint64 lines = 0;
+        double seconds = Benchmark::bestSeconds([&](){
+            QFuture<LogHistory::Batch> future = LogFileReader::parseRanges(reader, ranges, &pool);
+            future.waitForFinished();
+            lines = 0;
+            for(const LogHistory::Batch& batch : future.results())
+                lines += batch.lines.size();
+        }, 3);
+        if(lines != bench_lines){
+            fprintf(stderr, "%d threads parsed %lld lines, expected %d\n", count, lines, bench_lines);
+            return 1;
+        }
+        if(count == 1)
+            single = seconds;
+        printf("%2d threads, %3d ranges: %7.0f MiB/s, %5.1f Mlines/s, speedup %.2fx, efficiency %3.0f%%\n",
+               count, ranges.size(), megabytes / seconds, lines / seconds / 1e6,
+               single / seconds, 100 * single / seconds / count);
+    }
+    return 0;
+}
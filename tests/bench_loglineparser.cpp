@@ -0,0 +1,53 @@
+#include "Benchmark.h"
+#include "LogConsoleWidget.h"
+#include "LogLineGenerator.h"
+#include "LogLineParser.h"
+#include "qcoreapplication.h"
+#include <cstdio>
+
+using namespace Logging;
+
+const int bench_lines = 1000000;
+const double required_speedup = 10;  // LogLineParser против LogLine::parseHeader
+
+/*!
+ *  Замер разбора заголовков: прежний путь (QString::fromUtf8 + LogLine::parseHeader)
+ *  против LogLineParser на тех же байтах. Выводит строки/с и ускорение,
+ *  код возврата 1 - ускорение меньше required_speedup
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    LogLineGenerator generator;
+    QVector<QByteArray> headers;
+    headers.reserve(bench_lines);
+    for(int i = 0; i < bench_lines; i++)
+        headers.append(generator.header());
+
+    double before = Benchmark::bestSeconds([&headers](){
+        qint64 sum = 0;
+        for(const QByteArray& header : headers){
+            LogLine line;
+            line.parseHeader(QString::fromUtf8(header));
+            sum += line.timestamp;
+        }
+        Benchmark::keep(sum);
+    });
+    LogLineParser parser;
+    double after = Benchmark::bestSeconds([&headers, &parser](){
+        qint64 sum = 0;
+        for(const QByteArray& header : headers){
+            LogLine line;
+            parser.parseHeader(header.constData(), header.size(), line);
+            sum += line.timestamp;
+        }
+        Benchmark::keep(sum);
+    });
+
+    double speedup = before / after;
+    printf("LogLine::parseHeader: %.0f lines/s\n", bench_lines / before);
+    printf("LogLineParser:        %.0f lines/s\n", bench_lines / after);
+    printf("speedup: %.1fx (required %.0fx)\n", speedup, required_speedup);
+    return speedup >= required_speedup ? 0 : 1;
+}
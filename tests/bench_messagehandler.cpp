@@ -0,0 +1,87 @@
+#include "Benchmark.h"
+#include "Logging.h"
+#include "LoggingSymbols.h"
+#include "qcoreapplication.h"
+#include "qdatetime.h"
+#include <cstdio>
+
+using namespace Logging;
+
+const int bench_messages = 1000000;
+
+/*!
+ * \brief oldMessageHandler прежний обработчик с отключенными приемниками: время QDateTime,
+ *  разбор имени функции из Q_FUNC_INFO и строка LogLine::toQString на каждое сообщение
+ */
+static QString oldMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    QDateTime date = QDateTime::currentDateTime();
+
+    QString func = context.function;
+    int lastIndex = func.lastIndexOf('(');
+    func = func.left(lastIndex).trimmed();
+    int firstIndex = func.lastIndexOf(' ');
+    func = func.mid(firstIndex+1);
+
+    return QString("%1 %2 %3 >> %4")
+        .arg(date.toString("yyyy-MM-dd hh:mm:ss.zzz"), msgTypeToString(type), func, msg);
+}
+
+/*!
+ *  Замер обработчика сообщений на нескольких местах вызова.
+ *  Имя функции: прежний разбор Q_FUNC_INFO на каждом сообщении (FunctionTable::parseName)
+ *  против кеша по месту вызова (FunctionTable::idForCallSite).
+ *  Обработчик целиком - прежний (oldMessageHandler) и текущий, с отключенными приемниками,
+ *  чтобы вывод не заслонял сам обработчик
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    setEnableConsoleLogging(false);
+    setEnableFileLogging(false);
+
+    static const char* const functions[] = {
+        "void MainWindow::onTimer()",
+        "int ns::Parser::parse(const QByteArray&, int)",
+        "virtual bool Logging::LogConsoleWidget::event(QEvent*)",
+        "main(int, char**)::<lambda()>"
+    };
+    const int sites = int(sizeof(functions) / sizeof(functions[0]));
+    QMessageLogContext contexts[] = {
+        {"mainwindow.cpp", 10, functions[0], "default"},
+        {"parser.cpp", 20, functions[1], "default"},
+        {"LogConsoleWidget.cpp", 30, functions[2], "default"},
+        {"main.cpp", 40, functions[3], "default"}
+    };
+
+    double parse = Benchmark::bestSeconds([&](){
+        qint64 sum = 0;
+        for(int i = 0; i < bench_messages; i++)
+            sum += FunctionTable::parseName(functions[i % sites]).size();
+        Benchmark::keep(sum);
+    });
+    double cached = Benchmark::bestSeconds([&](){
+        qint64 sum = 0;
+        for(int i = 0; i < bench_messages; i++)
+            sum += FunctionTable::idForCallSite(functions[i % sites]);
+        Benchmark::keep(sum);
+    });
+    QString message("value changed");
+    double oldHandler = Benchmark::bestSeconds([&](){
+        qint64 sum = 0;
+        for(int i = 0; i < bench_messages; i++)
+            sum += oldMessageHandler(QtInfoMsg, contexts[i % sites], message).size();
+        Benchmark::keep(sum);
+    });
+    double handler = Benchmark::bestSeconds([&](){
+        for(int i = 0; i < bench_messages; i++)
+            messageHandler(QtInfoMsg, contexts[i % sites], message);
+    });
+
+    double nsPerMessage = 1e9 / bench_messages;
+    printf("function name, parsed per message: %.1f ns/msg\n", parse * nsPerMessage);
+    printf("function name, call-site cache:    %.1f ns/msg (%.1fx)\n", cached * nsPerMessage, parse / cached);
+    printf("old messageHandler, sinks off:     %.1f ns/msg\n", oldHandler * nsPerMessage);
+    printf("messageHandler, sinks off:         %.1f ns/msg (%.1fx)\n", handler * nsPerMessage, oldHandler / handler);
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "LoggingEncoder.h"
+#include <QtTest>
+#include <random>
+
+using namespace Logging;
+
+const int large_size = 3 * 1024 * 1024 + 7; // несколько МиБ, не кратно блокам ядер
+
+/*!
+ * \brief The TestEncoder class encodeBase64/decodeBase64 должны совпадать с QByteArray::toBase64
+ *  и QByteArray::fromBase64 для каждого ядра, которое поддерживает процессор:
+ *  все длины до 200 байт (хвосты и границы блоков), большой буфер и строки с недопустимыми символами
+ */
+class TestEncoder : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+    void encodeDecode_data();
+    void encodeDecode();
+    void invalidInput_data();
+    void invalidInput();
+    void encodedLine_data();
+    void encodedLine();
+
+private:
+    static void addKernels();
+    /*!
+     * \brief useKernel задает ядро строки данных, неподдерживаемое процессором пропускается
+     */
+    static bool useKernel(Encoder::Base64Kernel kernel);
+    static QByteArray randomBytes(int size, quint32 seed);
+    static QByteArray encode(const QByteArray& data);
+    static QByteArray decode(const QByteArray& text);
+};
+
+void TestEncoder::cleanup()
+{
+    // лучшее ядро процессора, как без тестов
+    for(Encoder::Base64Kernel kernel : {Encoder::Base64Avx2, Encoder::Base64Ssse3, Encoder::Base64Scalar})
+        if(Encoder::setBase64Kernel(kernel))
+            break;
+}
+
+void TestEncoder::addKernels()
+{
+    QTest::addColumn<int>("kernel");
+    QTest::newRow("scalar") << int(Encoder::Base64Scalar);
+    QTest::newRow("ssse3") << int(Encoder::Base64Ssse3);
+    QTest::newRow("avx2") << int(Encoder::Base64Avx2);
+}
+
+bool TestEncoder::useKernel(Encoder::Base64Kernel kernel)
+{
+    if(!Encoder::setBase64Kernel(kernel))
+        return false;
+    return Encoder::base64Kernel() == kernel;
+}
+
+QByteArray TestEncoder::randomBytes(int size, quint32 seed)
+{
+    std::mt19937 random(seed);
+    QByteArray data(size, Qt::Uninitialized);
+    for(int i = 0; i < size; i++)
+        data[i] = char(random() & 0xff);
+    return data;
+}
+
+QByteArray TestEncoder::encode(const QByteArray &data)
+{
+    QByteArray text(Encoder::base64Size(data.size()), Qt::Uninitialized);
+    text.resize(Encoder::encodeBase64(data.constData(), data.size(), text.data()));
+    return text;
+}
+
+QByteArray TestEncoder::decode(const QByteArray &text)
+{
+    QByteArray data(Encoder::base64DecodedMaxSize(text.size()), Qt::Uninitialized);
+    data.resize(Encoder::decodeBase64(text.constData(), text.size(), data.data()));
+    return data;
+}
+
+void TestEncoder::encodeDecode_data()
+{
+    addKernels();
+}
+
+void TestEncoder::encodeDecode()
+{
+    QFETCH(int, kernel);
+    if(!useKernel(Encoder::Base64Kernel(kernel)))
+        QSKIP("kernel is not supported by this processor");
+
+    QVector<int> sizes;
+    for(int size = 0; size <= 200; size++)
+        sizes.append(size);
+    sizes.append(large_size);
+    for(int size : sizes)
+    {
+        QByteArray data = randomBytes(size, quint32(size));
+        QByteArray expected = data.toBase64();
+        QByteArray text = encode(data);
+        QVERIFY2(text == expected, qPrintable(QString("encode, size %1").arg(size)));
+        QVERIFY2(decode(text) == data, qPrintable(QString("decode, size %1").arg(size)));
+        // без '=' в конце
+        QByteArray unpadded = data.toBase64(QByteArray::OmitTrailingEquals);
+        QVERIFY2(decode(unpadded) == data, qPrintable(QString("decode without padding, size %1").arg(size)));
+    }
+}
+
+void TestEncoder::invalidInput_data()
+{
+    addKernels();
+}
+
+void TestEncoder::invalidInput()
+{
+    QFETCH(int, kernel);
+    if(!useKernel(Encoder::Base64Kernel(kernel)))
+        QSKIP("kernel is not supported by this processor");
+
+    // длины, при которых ошибка попадает в блоки обоих векторных ядер и в скалярный хвост
+    const QList<int> sizes = {1, 2, 3, 30, 47, 48, 100, 200, 4096};
+    const QList<char> invalid = {'=', '*', '-', '_', ' ', '\n', '\0', char(0x80), char(0xff)};
+    for(int size : sizes)
+    {
+        QByteArray text = randomBytes(size, quint32(size) + 1000).toBase64();
+        for(char c : invalid)
+        {
+            for(int position : {0, text.size() / 3, text.size() / 2, text.size() - 5, text.size() - 1})
+            {
+                if(position < 0) continue;
+                QByteArray damaged = text;
+                damaged[position] = c;
+                QVERIFY2(decode(damaged) == QByteArray::fromBase64(damaged),
+                         qPrintable(QString("size %1, char 0x%2 at %3").arg(size).arg(uchar(c), 0, 16).arg(position)));
+                QByteArray inserted = text;
+                inserted.insert(position, c);
+                QVERIFY2(decode(inserted) == QByteArray::fromBase64(inserted),
+                         qPrintable(QString("size %1, char 0x%2 inserted at %3").arg(size).arg(uchar(c), 0, 16).arg(position)));
+            }
+        }
+        // '=' посередине: две склеенные строки base64
+        QByteArray joined = text + randomBytes(size, quint32(size) + 2000).toBase64();
+        QVERIFY2(decode(joined) == QByteArray::fromBase64(joined), qPrintable(QString("joined, size %1").arg(size)));
+    }
+}
+
+void TestEncoder::encodedLine_data()
+{
+    addKernels();
+}
+
+void TestEncoder::encodedLine()
+{
+    QFETCH(int, kernel);
+    if(!useKernel(Encoder::Base64Kernel(kernel)))
+        QSKIP("kernel is not supported by this processor");
+
+    const QString line = QString::fromUtf8("2024-03-01 10:11:12.013 INFO main >> значение = [1, 2, 3]");
+    QString encoded = Encoder::encodeLineString(line);
+    QVERIFY(Encoder::isLineStringEncoded(encoded));
+    QCOMPARE(encoded, QString::fromLatin1(Encoder::PrefixMarker + line.toUtf8().toBase64()));
+    QString decoded;
+    QVERIFY(Encoder::decodeLineString(encoded, decoded));
+    QCOMPARE(decoded, line);
+
+    QByteArray buffer;
+    QByteArray data = Encoder::encodeLineData(line.toUtf8());
+    QVERIFY(Encoder::decodeLine(data.constData(), data.size(), buffer));
+    QCOMPARE(buffer, line.toUtf8());
+    QVERIFY(!Encoder::decodeLine("plain line", 10, buffer));
+}
+
+QTEST_GUILESS_MAIN(TestEncoder)
+
+#include "tst_encoder.moc"
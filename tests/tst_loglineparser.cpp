@@ -0,0 +1,120 @@
+#include "LogConsoleWidget.h"
+#include "LogLineGenerator.h"
+#include "LogLineParser.h"
+#include <QtTest>
+
+using namespace Logging;
+
+const int generated_lines = 200000;
+
+/*!
+ * \brief The TestLogLineParser class LogLineParser должен разбирать любой заголовок
+ *  так же, как LogLine::parseHeader: сравнение по полям на заданных и сгенерированных строках
+ */
+class TestLogLineParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sameAsParseHeader_data();
+    void sameAsParseHeader();
+    void generatedHeaders();
+    void generatedQStringHeaders();
+
+private:
+    /*!
+     * \brief difference пустая строка, если оба разбора дали одно и то же, иначе - описание отличия
+     */
+    static QString difference(const QByteArray& header, bool ok, const LogLine& actual);
+};
+
+QString TestLogLineParser::difference(const QByteArray &header, bool ok, const LogLine &actual)
+{
+    LogLine expected;
+    bool expectedOk = expected.parseHeader(QString::fromUtf8(header));
+    QString where = QString("header \"%1\": ").arg(QString::fromUtf8(header));
+    if(ok != expectedOk)
+        return where + QString("parsed %1, expected %2").arg(ok).arg(expectedOk);
+    if(!ok)
+        return QString();
+    if(actual.timestamp != expected.timestamp)
+        return where + QString("timestamp %1, expected %2").arg(actual.timestamp).arg(expected.timestamp);
+    if(actual.type != expected.type)
+        return where + QString("type %1, expected %2").arg(actual.type).arg(expected.type);
+    if(actual.functionId != expected.functionId)
+        return where + QString("function \"%1\", expected \"%2\"")
+                           .arg(FunctionTable::name(actual.functionId), FunctionTable::name(expected.functionId));
+    if(actual.categoryId != expected.categoryId)
+        return where + QString("category \"%1\", expected \"%2\"")
+                           .arg(CategoryTable::name(actual.categoryId), CategoryTable::name(expected.categoryId));
+    return QString();
+}
+
+void TestLogLineParser::sameAsParseHeader_data()
+{
+    QTest::addColumn<QByteArray>("header");
+    QTest::newRow("full") << QByteArray("2024-02-29 23:59:59.999 WARNING ns::Class::method [app.net]");
+    QTest::newRow("no category") << QByteArray("2024-03-01 00:00:00.000 INFO main");
+    QTest::newRow("only category") << QByteArray("2024-03-01 00:00:00.000 DEBUG [app.net]");
+    QTest::newRow("no function") << QByteArray("2024-03-01 00:00:00.000 CRITICAL");
+    QTest::newRow("no level") << QByteArray("2024-03-01 00:00:00.000");
+    QTest::newRow("lowercase level") << QByteArray("1999-12-31 12:00:00.001 fatal f");
+    QTest::newRow("unknown level") << QByteArray("1999-12-31 12:00:00.001 TRACE f");
+    QTest::newRow("level inside word") << QByteArray("1999-12-31 12:00:00.001 xWARNINGx f");
+    QTest::newRow("no milliseconds") << QByteArray("2024-03-01 10:11:12 INFO f");
+    QTest::newRow("short fields") << QByteArray("2024-3-1 1:2:3.4 INFO f");
+    QTest::newRow("double spaces") << QByteArray("2024-03-01  10:11:12.013  INFO  f  [c]");
+    QTest::newRow("leading space") << QByteArray(" 2024-03-01 10:11:12.013 INFO f");
+    QTest::newRow("empty category") << QByteArray("2024-03-01 10:11:12.013 INFO f []");
+    QTest::newRow("open bracket") << QByteArray("2024-03-01 10:11:12.013 INFO f [c");
+    QTest::newRow("extra words") << QByteArray("2024-03-01 10:11:12.013 INFO f a b [c]");
+    QTest::newRow("tab") << QByteArray("2024-03-01\t10:11:12.013 INFO f");
+    QTest::newRow("letters in date") << QByteArray("2024-0a-01 10:11:12.013 INFO f");
+    QTest::newRow("not ascii") << QByteArray("2024-03-01 10:11:12.013 INFO Модуль::функция [категория]");
+    QTest::newRow("empty") << QByteArray("");
+    QTest::newRow("two words") << QByteArray("hello world");
+}
+
+void TestLogLineParser::sameAsParseHeader()
+{
+    QFETCH(QByteArray, header);
+    LogLineParser parser;
+    LogLine line;
+    bool ok = parser.parseHeader(header.constData(), header.size(), line);
+    QString diff = difference(header, ok, line);
+    QVERIFY2(diff.isEmpty(), qPrintable(diff));
+}
+
+void TestLogLineParser::generatedHeaders()
+{
+    // один разборщик на все строки: проверяется и запомненная дата предыдущей строки
+    LogLineGenerator generator(2024);
+    LogLineParser parser;
+    for(int i = 0; i < generated_lines; i++)
+    {
+        QByteArray header = (i % 4 == 0) ? generator.malformedHeader() : generator.header();
+        LogLine line;
+        bool ok = parser.parseHeader(header.constData(), header.size(), line);
+        QString diff = difference(header, ok, line);
+        QVERIFY2(diff.isEmpty(), qPrintable(diff));
+    }
+}
+
+void TestLogLineParser::generatedQStringHeaders()
+{
+    LogLineGenerator generator(7);
+    LogLineParser parser;
+    for(int i = 0; i < generated_lines / 4; i++)
+    {
+        QByteArray header = (i % 4 == 0) ? generator.malformedHeader() : generator.header();
+        QString text = QString::fromUtf8(header);
+        LogLine line;
+        bool ok = parser.parseHeader(text.constData(), text.size(), line);
+        QString diff = difference(header, ok, line);
+        QVERIFY2(diff.isEmpty(), qPrintable(diff));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestLogLineParser)
+
+#include "tst_loglineparser.moc"